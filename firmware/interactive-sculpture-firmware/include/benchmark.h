@@ -0,0 +1,48 @@
+/**
+ * @file        benchmark.h
+ * @author      Simon Håkansson
+ * @date        2025-09-22
+ * @brief       Cycle-count benchmarks for the ATmega328P, run under simavr.
+ *
+ * @details     Only built when BENCHMARK is defined (the bench environments).
+ * Timer1 runs at the CPU clock as a 32-bit cycle counter, and the SRAM
+ * between the end of .bss and the top of the stack is painted at reset so
+ * the deepest stack use can be read back afterwards. Results are printed as
+ * a single JSON line starting with "bench:", then the CPU is put to sleep
+ * with interrupts off, which ends a simavr run.
+ *
+ *              Cycle counts include any interrupts that fired during the
+ *              call (Timer0 for millis(), Timer1 overflows, serial), the same
+ *              as they would on hardware.
+ *
+ *              The native build counts simulated time instead, converted to
+ *              cycles at F_CPU. That covers the I2C bus and delays but not
+ *              the computation, and there is no SRAM figure. It answers
+ *              whether the bus traffic of a frame fits in the servo period.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#ifdef BENCHMARK
+
+#include <hal.h>
+
+// Timed calls per benchmarked function
+const uint16_t BENCHMARK_ITERATIONS = 200;
+
+typedef void (*BenchmarkFunction)();
+
+void initializeBenchmark();
+void benchmarkFunction(const __FlashStringHelper *name, BenchmarkFunction function,
+                       uint16_t iterations, unsigned long settleMicros = 0);
+void finishBenchmark();
+
+#endif // BENCHMARK
+
+#endif // BENCHMARK_H
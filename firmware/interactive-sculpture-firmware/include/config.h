@@ -20,21 +20,60 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+#include <stdint.h>
+
 //-------------[ HARDWARE PINS & ADDRESSES ]-------------
-// Serial communication baud rate
+// Serial communication baud rate at boot, before the host negotiates a faster one
 #define BAUD_RATE 9600 
 
-// Number of leaves in the sculpture
-#define NUM_LEAVES 2 
+// Faster rates the host may negotiate. Each divides the 16 MHz clock exactly,
+// so the UART runs them without divisor error.
+constexpr unsigned long NEGOTIATED_BAUD_RATES[] = {1000000, 500000, 250000};
+const unsigned long BAUD_CONFIRM_TIMEOUT_MS = 500; // Time for the host to confirm a new rate
+const uint8_t LINK_ERROR_LIMIT = 8; // Garbled messages per window before falling back
+const unsigned long LINK_ERROR_WINDOW_MS = 1000;
+
+// I2C address of the first PCA9685 servo driver and the bus speed. Chained
+// boards are strapped to the following addresses.
+#define PCA9685_I2C_ADDRESS 0x40
+#define I2C_CLOCK_HZ 400000
 
-// Define the pin positions for the leaves on the PCA9685 servo driver
+// Define where each leaf's servo is connected. Listing leaves in board and
+// channel order lets neighbouring servos share one I2C burst.
+// LEAF_PINS, LEAF_RANGES and LEAF_BASELINES are only read at compile time;
+// leaf_config.h folds them into one flash record per leaf.
 struct Leaf {
-    int servoPin; // Pin connected to the servo motor
+    uint8_t boardAddress; // I2C address of the PCA9685 driving the servo
+    uint8_t channel; // PCA9685 channel connected to the servo motor
+    int trimMicroseconds; // Per-servo offset added to every pulse
 };
-const Leaf LEAF_PINS[NUM_LEAVES] = {
-    {0}, // Leaf 1 servo pin
-    {1},
+
+#ifdef LEAF_LAYOUT_48
+// Full installation: 48 leaves on three PCA9685 boards
+#define NUM_LEAVES 48
+constexpr Leaf LEAF_PINS[NUM_LEAVES] = {
+    {PCA9685_I2C_ADDRESS + 0,  0, 0}, {PCA9685_I2C_ADDRESS + 0,  1, 0}, {PCA9685_I2C_ADDRESS + 0,  2, 0}, {PCA9685_I2C_ADDRESS + 0,  3, 0},
+    {PCA9685_I2C_ADDRESS + 0,  4, 0}, {PCA9685_I2C_ADDRESS + 0,  5, 0}, {PCA9685_I2C_ADDRESS + 0,  6, 0}, {PCA9685_I2C_ADDRESS + 0,  7, 0},
+    {PCA9685_I2C_ADDRESS + 0,  8, 0}, {PCA9685_I2C_ADDRESS + 0,  9, 0}, {PCA9685_I2C_ADDRESS + 0, 10, 0}, {PCA9685_I2C_ADDRESS + 0, 11, 0},
+    {PCA9685_I2C_ADDRESS + 0, 12, 0}, {PCA9685_I2C_ADDRESS + 0, 13, 0}, {PCA9685_I2C_ADDRESS + 0, 14, 0}, {PCA9685_I2C_ADDRESS + 0, 15, 0},
+    {PCA9685_I2C_ADDRESS + 1,  0, 0}, {PCA9685_I2C_ADDRESS + 1,  1, 0}, {PCA9685_I2C_ADDRESS + 1,  2, 0}, {PCA9685_I2C_ADDRESS + 1,  3, 0},
+    {PCA9685_I2C_ADDRESS + 1,  4, 0}, {PCA9685_I2C_ADDRESS + 1,  5, 0}, {PCA9685_I2C_ADDRESS + 1,  6, 0}, {PCA9685_I2C_ADDRESS + 1,  7, 0},
+    {PCA9685_I2C_ADDRESS + 1,  8, 0}, {PCA9685_I2C_ADDRESS + 1,  9, 0}, {PCA9685_I2C_ADDRESS + 1, 10, 0}, {PCA9685_I2C_ADDRESS + 1, 11, 0},
+    {PCA9685_I2C_ADDRESS + 1, 12, 0}, {PCA9685_I2C_ADDRESS + 1, 13, 0}, {PCA9685_I2C_ADDRESS + 1, 14, 0}, {PCA9685_I2C_ADDRESS + 1, 15, 0},
+    {PCA9685_I2C_ADDRESS + 2,  0, 0}, {PCA9685_I2C_ADDRESS + 2,  1, 0}, {PCA9685_I2C_ADDRESS + 2,  2, 0}, {PCA9685_I2C_ADDRESS + 2,  3, 0},
+    {PCA9685_I2C_ADDRESS + 2,  4, 0}, {PCA9685_I2C_ADDRESS + 2,  5, 0}, {PCA9685_I2C_ADDRESS + 2,  6, 0}, {PCA9685_I2C_ADDRESS + 2,  7, 0},
+    {PCA9685_I2C_ADDRESS + 2,  8, 0}, {PCA9685_I2C_ADDRESS + 2,  9, 0}, {PCA9685_I2C_ADDRESS + 2, 10, 0}, {PCA9685_I2C_ADDRESS + 2, 11, 0},
+    {PCA9685_I2C_ADDRESS + 2, 12, 0}, {PCA9685_I2C_ADDRESS + 2, 13, 0}, {PCA9685_I2C_ADDRESS + 2, 14, 0}, {PCA9685_I2C_ADDRESS + 2, 15, 0},
+};
+#else
+// Number of leaves in the sculpture
+#define NUM_LEAVES 2 
+
+constexpr Leaf LEAF_PINS[NUM_LEAVES] = {
+    {PCA9685_I2C_ADDRESS, 0, 0}, // Leaf 1 board, channel and trim
+    {PCA9685_I2C_ADDRESS, 1, 0},
 };
+#endif
 
 // Define Ultrasonic sensor pins
 // Approach sensor
@@ -49,6 +88,10 @@ const Leaf LEAF_PINS[NUM_LEAVES] = {
 #define PULSEWIDTH_MAX 2500
 #define SERVO_MAX_ANGLE 270
 #define SERVO_FREQUENCY 50
+// Motion frames computed and sent per second. Rates above SERVO_FREQUENCY
+// only produce pulses the servos never see.
+const unsigned long MOTION_FRAME_RATE_HZ = SERVO_FREQUENCY;
+#define PCA9685_OSCILLATOR_FREQUENCY 25000000 // Trim to the measured value of the board
 
 // -------------[ ULTRASONIC SENSOR CALIBRATION ]-------------
 // An enum to create clear, readable names for the sensors
@@ -56,34 +99,94 @@ enum SensorType {
   APPROACH_SENSOR,
   INTERACTION_SENSOR
 };
+const int NUM_ULTRASONIC_SENSORS = 2; // Number of entries in SensorType
+
+// Wiring and firing order of each sensor, indexed by SensorType. Sensors in
+// the same ping slot fire together, ULTRASONIC_STAGGER_US apart; the slots
+// fire one after the other. Sensors that face each other belong in
+// different slots. A sensor stops listening once an echo from beyond its
+// maximum range would be due, and reports ULTRASONIC_OUT_OF_RANGE_CM.
+struct UltrasonicSensor {
+    uint8_t triggerPin;
+    uint8_t echoPin;
+    uint8_t pingSlot; // Sensors sharing a slot are triggered together
+    float maxRangeCm; // Farthest distance worth waiting for
+};
+constexpr UltrasonicSensor ULTRASONIC_SENSORS[NUM_ULTRASONIC_SENSORS] = {
+    {APPROACH_TRIG_PIN, APPROACH_ECHO_PIN, 0, 100},
+    {INTERACTION_TRIG_PIN, INTERACTION_ECHO_PIN, 0, 50},
+};
 
 // Ultrasonic sensor timing and conversion
 const int ULTRASONIC_CLEAR_PULSE = 2; // in microseconds
 const int ULTRASONIC_TRIGGER_PULSE = 10; // in microseconds
-const float SPEED_OF_SOUND = 0.0343; // cm per microsecond
+constexpr float SPEED_OF_SOUND = 0.0343; // cm per microsecond
+const unsigned long ULTRASONIC_ECHO_DELAY_US = 1000; // Trigger to echo rise, with margin (HC-SR04: about 450)
+
+// Quiet time after a ping slot before the next one fires, so echoes from
+// beyond the sensors' maximum range have faded
+const unsigned long ULTRASONIC_SLOT_GUARD_US = 10000;
+
+// Crosstalk rejection. The trigger order within a slot reverses every cycle,
+// which moves a reading taken from another sensor's burst by about twice the
+// stagger, or 100 cm. A real echo only moves as fast as the visitor.
+const unsigned long ULTRASONIC_STAGGER_US = 3000;
+const float ULTRASONIC_CROSSTALK_TOLERANCE_CM = 25; // Largest real change per cycle
 
 // Sampling Interval for the sensors
 const int SAMPLING_INTERVAL_MS = 100; // 100 ms between readings
 
+// Distance filter, run on every published reading before the thresholds.
+// A reading further than DISTANCE_MAX_STEP_MM from the last accepted one is
+// dropped as an outlier, unless DISTANCE_STEP_CONFIRMATIONS readings in a row
+// agree it is real, each within DISTANCE_MAX_STEP_MM of the first. Accepted
+// readings go through a running median and then an exponential moving average.
+const uint8_t DISTANCE_MEDIAN_WINDOW = 5; // Readings in the running median, odd
+const uint8_t DISTANCE_EMA_WEIGHT_Q8 = 128; // Weight of each new median, in 1/256
+const uint16_t DISTANCE_MAX_STEP_MM = 300; // 3 m/s at SAMPLING_INTERVAL_MS
+const uint8_t DISTANCE_STEP_CONFIRMATIONS = 2;
+
 //-------------[ PHYSICAL CONSTRAINTS ]-------------
 // Define the safe movement range for each of the leaves
  struct AngleRange {
     int minAngle; // Minimum angle in degrees
     int maxAngle; // Maximum angle in degrees
+    float maxSpeed; // Slew-rate limit in degrees per second
+};
+#ifdef LEAF_LAYOUT_48
+constexpr AngleRange LEAF_RANGES[NUM_LEAVES] = {
+    {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180},
+    {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180},
+    {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180},
+    {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180},
+    {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180},
+    {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180},
+    {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180},
+    {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180}, {45, 135, 180},
 };
-const AngleRange LEAF_RANGES[NUM_LEAVES] = {
-    {45, 135}, // Leaf 1 range
-    {45, 135},
+#else
+constexpr AngleRange LEAF_RANGES[NUM_LEAVES] = {
+    {45, 135, 180}, // Leaf 1 range and slew limit
+    {45, 135, 180},
 };
-//TODO: Add more leaves with their ranges 
+#endif
 
-// Sensor threshold distances in cm
-#define APPROACH_THRESHOLD_CM 30.0 
-#define INTERACTION_THRESHOLD_CM 10.0
+// Sensor threshold distances in cm. A state is entered at the ENTER distance
+// and left only beyond the EXIT distance, so a visitor standing right at a
+// threshold does not toggle between states.
+#define APPROACH_ENTER_CM 30.0
+#define APPROACH_EXIT_CM 35.0
+#define INTERACTION_ENTER_CM 10.0
+#define INTERACTION_EXIT_CM 13.0
+
+// Minimum time spent in each user state before it may change again
+const unsigned long NO_USER_DWELL_MS = 500;
+const unsigned long USER_APPROACHING_DWELL_MS = 300;
+const unsigned long USER_INTERACTING_DWELL_MS = 1000;
 
 //-------------[ MOVEMENT SET CONFIGURATIONS ]-------------
-// Declare the array of current phases for each leaf.
-extern float currentPhases[];
+// Declare the array of current phases for each leaf (binary angle, 2^32 per turn).
+extern uint32_t currentPhases[];
 
 // Declaration of the leaf baseline movement
 struct BaselineMovement {
@@ -91,11 +194,39 @@ struct BaselineMovement {
     float phaseOffset; // Phase offset for sine wave motion
 };
 // Define the baseline movement for each leaf
-const BaselineMovement LEAF_BASELINES[NUM_LEAVES] = {
-    {0.001, 0.0}, // Leaf 1 baseline movement (speed in radians per loop, phase offset in radians)
-    {0.0015, 0.3},
+#ifdef LEAF_LAYOUT_48
+constexpr BaselineMovement LEAF_BASELINES[NUM_LEAVES] = {
+    {0.50, 0.00}, {0.73, 0.39}, {0.97, 0.79}, {0.67, 1.18},
+    {0.90, 1.57}, {0.60, 1.96}, {0.83, 2.36}, {0.53, 2.75},
+    {0.77, 3.14}, {1.00, 3.53}, {0.70, 3.93}, {0.93, 4.32},
+    {0.63, 4.71}, {0.87, 5.11}, {0.57, 5.50}, {0.80, 5.89},
+    {0.50, 0.00}, {0.73, 0.39}, {0.97, 0.79}, {0.67, 1.18},
+    {0.90, 1.57}, {0.60, 1.96}, {0.83, 2.36}, {0.53, 2.75},
+    {0.77, 3.14}, {1.00, 3.53}, {0.70, 3.93}, {0.93, 4.32},
+    {0.63, 4.71}, {0.87, 5.11}, {0.57, 5.50}, {0.80, 5.89},
+    {0.50, 0.00}, {0.73, 0.39}, {0.97, 0.79}, {0.67, 1.18},
+    {0.90, 1.57}, {0.60, 1.96}, {0.83, 2.36}, {0.53, 2.75},
+    {0.77, 3.14}, {1.00, 3.53}, {0.70, 3.93}, {0.93, 4.32},
+    {0.63, 4.71}, {0.87, 5.11}, {0.57, 5.50}, {0.80, 5.89},
+};
+#else
+constexpr BaselineMovement LEAF_BASELINES[NUM_LEAVES] = {
+    {0.6, 0.0}, // Leaf 1 baseline movement (speed in radians per second, phase offset in radians)
+    {0.9, 0.3},
     
 };
+#endif
+
+// Startup ramp. After a reset the leaves are switched on one at a time, each
+// given time to reach its starting pose before the next, so only one servo
+// draws stall current at once. Animation starts once the last one settles.
+const unsigned long STARTUP_LEAF_INTERVAL_MS = 100;
+const unsigned long STARTUP_SETTLE_MS = 300;
+
+// Fixed timestep of the motion integrator. Phases advance in whole steps of
+// this size no matter how often loop() runs.
+const unsigned long MOTION_TIMESTEP_US = 5000; // 200 Hz
+const float MOTION_TIMESTEP_S = MOTION_TIMESTEP_US / 1000000.0;
 
 
 //-------------[ STATE MACHINE DEFINITION ]-------------
@@ -114,18 +245,75 @@ enum MovementState {
     REACTING_NEGATIVE,
     REACTING_NEUTRAL
 };
+const int NUM_MOVEMENT_STATES = 5; // Number of entries in MovementState
+
+//-------------[ WAVEFORMS ]-------------
+// Shapes a leaf can follow over one animation cycle. The motion kernel turns
+// each into a 256-step table in flash at compile time, so they all cost the
+// same to evaluate.
+enum WaveformId {
+    WAVEFORM_SINE,      // Plain undulation
+    WAVEFORM_SHIVER,    // Slow swing with a fast tremble on top
+    WAVEFORM_BLOOM,     // Opens quickly, lingers, then folds back slowly
+    NUM_WAVEFORMS
+};
+
+// One sine component of a harmonic waveform
+struct Harmonic {
+    int multiple;       // Cycles per animation cycle
+    float amplitude;    // Share of the full swing, amplitudes must sum to 1 or less
+    float phase;        // Offset in radians
+};
+constexpr Harmonic SHIVER_HARMONICS[] = {
+    {1, 0.6, 0.0},
+    {9, 0.25, 0.0},
+    {13, 0.15, 1.57},
+};
+
+// Keyframes of a waveform in [-1, 1], evenly spaced over one cycle, with the
+// first one repeated at the end. Any number of keyframes works.
+constexpr float BLOOM_KEYFRAMES[] = {
+    -1.0, -0.6, 0.1, 0.7, 1.0, 1.0, 1.0, 0.9,
+    0.7, 0.45, 0.2, -0.1, -0.4, -0.65, -0.85, -0.95,
+    -1.0,
+};
 
 // Define the movement sets for different states
 struct MovementSet {
     float amplitude;    // How wide the movement is
     float centerAngle;  // The midpoint of the movement
-    float speedFactor;  // The speed of the sine wave (times baseline speed)
+    float speedFactor;  // The speed of the waveform (times baseline speed)
+    WaveformId waveform; // The shape of the movement
 };
-const MovementSet IDLE_MOVEMENT = {25.0, 90.0, 1};
-const MovementSet LISTEN_MOVEMENT = {3.0, 20.0, 0.5};
-const MovementSet POSITIVE_MOVEMENT = {25.0, 90, 2};
-const MovementSet NEGATIVE_MOVEMENT = {5, 135, 3};
-const MovementSet NEUTRAL_MOVEMENT = {20, 90, 1.5};
+// Each set's whole swing must fit the range every leaf in LEAF_RANGES can
+// follow, the same check uploaded sets go through.
+constexpr MovementSet IDLE_MOVEMENT = {25.0, 90.0, 1, WAVEFORM_SINE};
+constexpr MovementSet LISTEN_MOVEMENT = {3.0, 48.0, 0.5, WAVEFORM_SINE}; // Drawn in to the bottom of LEAF_RANGES, barely moving
+constexpr MovementSet POSITIVE_MOVEMENT = {25.0, 90, 2, WAVEFORM_BLOOM};
+constexpr MovementSet NEGATIVE_MOVEMENT = {5, 130, 3, WAVEFORM_SHIVER}; // Pressed up against the top of LEAF_RANGES
+constexpr MovementSet NEUTRAL_MOVEMENT = {20, 90, 1.5, WAVEFORM_SINE};
 // TODO: Add more movement sets
 
+// Shapes a transition can follow from one movement set to the next
+enum EasingCurve {
+    EASE_LINEAR,        // Constant rate, abrupt start and stop
+    EASE_SMOOTHSTEP,    // Starts and stops with zero velocity
+    EASE_SMOOTHERSTEP   // Also zero acceleration at both ends
+};
+
+// How long a change of movement state takes to blend in, and its shape
+const unsigned long MOVEMENT_TRANSITION_MS = 1500;
+const EasingCurve MOVEMENT_TRANSITION_EASING = EASE_SMOOTHERSTEP;
+
+//-------------[ MOVEMENT STORE ]-------------
+// The sets above are the defaults. The host can upload replacements, which
+// are kept in EEPROM. Every save goes to the next slot of a ring spread over
+// this area, so no single cell takes all the writes.
+const uint16_t MOVEMENT_STORE_ADDRESS = 0;
+const uint16_t MOVEMENT_STORE_LENGTH = 1024; // The whole EEPROM of the ATmega328P
+const uint8_t MOVEMENT_STORE_VERSION = 1; // Change whenever MovementSet changes
+
+// Fastest speedFactor an uploaded movement set may ask for
+constexpr float MAX_MOVEMENT_SPEED_FACTOR = 4.0;
+
 #endif // CONFIG_H
\ No newline at end of file
@@ -0,0 +1,33 @@
+/**
+ * @file        distance_filter.h
+ * @author      Simon Håkansson
+ * @date        2025-10-06
+ * @brief       Outlier gate, running median and moving average for sensor distances.
+ *
+ * @details     One filter per ultrasonic sensor turns the published readings
+ * into a steady distance for the user detection thresholds, so a single
+ * stray echo cannot start or end an interaction. The filter takes and
+ * returns whole millimeters and works with fixed-size buffers, integer math
+ * and no allocation. Published readings in cm are converted once, on the
+ * way in.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+
+#ifndef DISTANCE_FILTER_H
+#define DISTANCE_FILTER_H
+
+#include <stdint.h>
+#include <config.h>
+
+// Millimeter value of a reading with no echo in range. It sorts after every
+// distance, so the median treats it as the farthest reading.
+const uint16_t DISTANCE_OUT_OF_RANGE_MM = 0xFFFF;
+
+uint16_t distanceToMillimeters(float distanceCm);
+uint16_t filterDistance(SensorType sensor, uint16_t distanceMm);
+
+#endif // DISTANCE_FILTER_H
@@ -0,0 +1,26 @@
+/**
+ * @file        frame_scheduler.h
+ * @author      Simon Håkansson
+ * @date        2025-09-10
+ * @brief       Fixed-rate scheduler for leaf motion frames.
+ *
+ * @details     Servos only act on a new pulse once per PWM period, so motion
+ * frames are computed and sent at MOTION_FRAME_RATE_HZ and the loop is free
+ * for sensors and serial in between. The scheduler keeps statistics on how
+ * late each frame starts relative to its deadline, over the time since they
+ * were last printed.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+
+#ifndef FRAME_SCHEDULER_H
+#define FRAME_SCHEDULER_H
+
+void initializeFrameScheduler();
+bool isMotionFrameDue();
+void printFrameStats();
+
+#endif // FRAME_SCHEDULER_H
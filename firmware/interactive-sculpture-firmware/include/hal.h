@@ -0,0 +1,30 @@
+/**
+ * @file        hal.h
+ * @author      Simon Håkansson
+ * @date        2025-09-19
+ * @brief       Hardware abstraction layer for the sculpture firmware.
+ *
+ * @details     Firmware sources include this instead of Arduino.h. On the
+ * board it pulls in the Arduino core, Wire, EEPROM and the PCA9685 driver. In the
+ * native build it provides the same API backed by simulated hardware, see
+ * hal_native.h.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+
+#ifndef HAL_H
+#define HAL_H
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <Wire.h>
+#include <EEPROM.h>
+#include <Adafruit_PWMServoDriver.h>
+#else
+#include <hal_native.h>
+#endif
+
+#endif // HAL_H
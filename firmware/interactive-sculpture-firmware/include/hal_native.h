@@ -0,0 +1,224 @@
+/**
+ * @file        hal_native.h
+ * @author      Simon Håkansson
+ * @date        2025-09-19
+ * @brief       Simulated Arduino backend for the native build.
+ *
+ * @details     Provides the subset of the Arduino, Wire, AVR and PCA9685
+ * driver APIs the firmware uses, so the same sources build for the host.
+ * Time is simulated: it only moves when simAdvanceMicros() or a delay is
+ * called, which makes runs deterministic and faster than real time.
+ * Ultrasonic sensors answer trigger pulses with echo edges that fire the
+ * firmware's pin-change ISRs, the serial port is a pair of byte queues, and
+ * the I2C bus counts bytes and keeps the PCA9685 channel registers. The
+ * EEPROM keeps its contents across simReset(), like a power cycle.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+
+#ifndef HAL_NATIVE_H
+#define HAL_NATIVE_H
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+//-------------[ CORE ]-------------
+#define F_CPU 16000000UL
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define DEC 10
+#define HEX 16
+#define PI 3.1415926535897932384626433832795
+
+typedef uint8_t byte;
+
+#define bit(b) (1UL << (b))
+
+template <typename T, typename U> inline T min(T a, U b) { return a < b ? a : (T)b; }
+template <typename T, typename U> inline T max(T a, U b) { return a > b ? a : (T)b; }
+template <typename T, typename U, typename V> inline T constrain(T x, U low, V high) {
+  return x < low ? (T)low : (x > high ? (T)high : x);
+}
+
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t value);
+int digitalRead(uint8_t pin);
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+inline void noInterrupts() {}
+inline void interrupts() {}
+
+//-------------[ FLASH ]-------------
+#define PROGMEM
+#define PSTR(s) (s)
+
+// Reads a value of any type from "flash", copied so it does not break
+// strict aliasing whatever the address points to
+template <typename T> inline T simReadFlash(const void *address) {
+  T value;
+  memcpy(&value, address, sizeof(value));
+  return value;
+}
+
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+#define pgm_read_word(address) simReadFlash<uint16_t>(address)
+#define pgm_read_dword(address) simReadFlash<uint32_t>(address)
+#define pgm_read_float(address) simReadFlash<float>(address)
+#define pgm_read_ptr(address) simReadFlash<void *>(address)
+#define memcpy_P memcpy
+#define strcmp_P strcmp
+#define strncmp_P strncmp
+#define strlen_P strlen
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+//-------------[ PIN-CHANGE INTERRUPTS ]-------------
+// Uno layout: pins 0-7 are port D (PCINT2), 8-13 port B (PCINT0) and
+// 14-19 port C (PCINT1)
+#define ISR(vector) extern "C" void vector(void)
+#define PCINT0_vect simPinChangeVector0
+#define PCINT1_vect simPinChangeVector1
+#define PCINT2_vect simPinChangeVector2
+
+extern volatile uint8_t PCICR;
+extern volatile uint8_t simPinChangeMasks[3];
+extern volatile uint8_t simPortInputs[3];
+
+inline uint8_t simPinGroup(uint8_t pin) { return pin <= 7 ? 2 : (pin <= 13 ? 0 : 1); }
+inline uint8_t simPinBit(uint8_t pin) { return pin <= 7 ? pin : (pin <= 13 ? pin - 8 : pin - 14); }
+
+#define digitalPinToPCICR(pin) (&PCICR)
+#define digitalPinToPCICRbit(pin) (simPinGroup(pin))
+#define digitalPinToPCMSK(pin) (&simPinChangeMasks[simPinGroup(pin)])
+#define digitalPinToPCMSKbit(pin) (simPinBit(pin))
+#define digitalPinToPort(pin) (simPinGroup(pin))
+#define digitalPinToBitMask(pin) ((uint8_t)(1 << simPinBit(pin)))
+#define portInputRegister(port) (&simPortInputs[port])
+
+//-------------[ SERIAL ]-------------
+class SimSerial {
+public:
+  void begin(unsigned long baud);
+  void end() {}
+  int available();
+  int read();
+  int peek();
+  void flush() {}
+  int availableForWrite() { return 63; }
+
+  size_t write(uint8_t c);
+  size_t write(const uint8_t *buffer, size_t size);
+
+  size_t print(const char *s);
+  size_t print(const __FlashStringHelper *s) { return print(reinterpret_cast<const char *>(s)); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(int n, int base = DEC) { return print((long)n, base); }
+  size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+  size_t print(long n, int base = DEC);
+  size_t print(unsigned long n, int base = DEC);
+  size_t print(double n, int digits = 2);
+
+  size_t println() { return write((uint8_t)'\n'); }
+  template <typename T> size_t println(T value) { size_t n = print(value); return n + println(); }
+  template <typename T> size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+
+  unsigned long baudRate() const { return baud; }
+
+private:
+  unsigned long baud = 0;
+};
+
+extern SimSerial Serial;
+
+//-------------[ I2C ]-------------
+#define BUFFER_LENGTH 32
+
+class SimWire {
+public:
+  void begin() {}
+  void setClock(uint32_t clock) { clockHz = clock; }
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t data);
+  uint8_t endTransmission(bool stop = true);
+
+  uint32_t clock() const { return clockHz; }
+
+private:
+  uint32_t clockHz = 100000;
+  uint8_t address = 0;
+  uint8_t buffer[BUFFER_LENGTH];
+  uint8_t length = 0;
+};
+
+extern SimWire Wire;
+
+//-------------[ PCA9685 DRIVER ]-------------
+#define PCA9685_LED0_ON_L 0x06
+#define FREQUENCY_OSCILLATOR 25000000
+
+class Adafruit_PWMServoDriver {
+public:
+  Adafruit_PWMServoDriver(uint8_t address = 0x40) : address(address) {}
+  bool begin() { Wire.begin(); return true; }
+  void setOscillatorFrequency(uint32_t) {}
+  void setPWMFreq(float) {}
+  uint8_t setPWM(uint8_t channel, uint16_t on, uint16_t off);
+
+private:
+  uint8_t address;
+};
+
+//-------------[ EEPROM ]-------------
+#define E2END 0x3FF
+
+class SimEEPROM {
+public:
+  SimEEPROM();
+  uint8_t read(int address);
+  void write(int address, uint8_t value);
+  void update(int address, uint8_t value);
+  uint16_t length() { return E2END + 1; }
+};
+
+extern SimEEPROM EEPROM;
+
+bool eeprom_is_ready();
+
+//-------------[ SIMULATION CONTROL ]-------------
+// PCA9685 boards the simulated bus keeps registers for (0x40 and up)
+const uint8_t SIM_PCA9685_BOARDS = 8;
+
+void simReset();
+void simAdvanceMicros(unsigned long us);
+uint64_t simMicros();
+
+void simAttachUltrasonic(uint8_t triggerPin, uint8_t echoPin);
+void simSetUltrasonicDistance(uint8_t echoPin, float distanceCm);
+void simSetUltrasonicCrosstalk(float pathCm);
+
+void simSerialInput(const char *data, size_t length);
+void simSetSerialOutput(void (*sink)(uint8_t c));
+
+unsigned long simWireBytes();
+unsigned long simWireTransactions();
+void simNackWireTransmissions(uint8_t count);
+uint16_t simServoTicks(uint8_t address, uint8_t channel);
+void simSetServoListener(void (*listener)(uint8_t address, uint8_t channel, uint16_t ticks));
+
+void simEraseEEPROM();
+unsigned long simEEPROMWrites();
+
+#endif // HAL_NATIVE_H
@@ -0,0 +1,75 @@
+/**
+ * @file        host_protocol.h
+ * @author      Simon Håkansson
+ * @date        2025-09-15
+ * @brief       Text and binary messaging between the firmware and the host.
+ *
+ * @details     Events go to the host either as text lines ("event:...") or,
+ * once the host has sent "protocol:binary", as compact binary frames. A
+ * binary frame is an opcode, a payload and a CRC8, COBS-encoded and ended by
+ * a 0x00 byte. The host returns to text with an OPCODE_TEXT_MODE frame.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+
+#ifndef HOST_PROTOCOL_H
+#define HOST_PROTOCOL_H
+
+#include <stdint.h>
+
+// Events reported to the host. The values are the binary event ids.
+enum HostEvent {
+  EVENT_USER_APPROACH_START,
+  EVENT_USER_APPROACH_END,
+  EVENT_USER_INTERACTION_START,
+  EVENT_USER_INTERACTION_END,
+  EVENT_READY,  // Leaves are in place and animating
+  NUM_HOST_EVENTS
+};
+
+// Binary opcodes. Host to firmware below 0x80, firmware to host above.
+enum HostOpcode {
+  OPCODE_SET_STATE = 0x01,          // [state]
+  OPCODE_SET_TELEMETRY = 0x02,      // [telemetry mask]
+  OPCODE_TEXT_MODE = 0x03,          // []
+  OPCODE_UPLOAD_MOVEMENT = 0x04,    // [state][amplitude f32][center f32][speed f32][waveform]
+  OPCODE_ACTIVATE_MOVEMENTS = 0x05, // []
+  OPCODE_DEFAULT_MOVEMENTS = 0x06,  // [], stage the built-in sets
+  OPCODE_EVENT = 0x81,              // [event]
+  OPCODE_MOVEMENT_STATE = 0x82,     // [state]
+  OPCODE_DISTANCES = 0x83,          // [approach mm u16][interaction mm u16], 0xFFFF out of range
+  OPCODE_LEAF_STATE = 0x84,         // [leaf][phase u16][pulse ticks u16]
+  OPCODE_LINK_FALLBACK = 0x85,      // [], link is about to drop to BAUD_RATE
+  OPCODE_MOVEMENT_RESULT = 0x86     // [result]
+};
+
+// Replies to movement set uploads. The values are the binary result ids.
+enum MovementResult {
+  MOVEMENT_REJECTED,
+  MOVEMENT_STAGED,
+  MOVEMENTS_ACTIVE,
+  NUM_MOVEMENT_RESULTS
+};
+
+// Telemetry streams the host can switch on with OPCODE_SET_TELEMETRY
+const uint8_t TELEMETRY_DISTANCES = 0x01;
+const uint8_t TELEMETRY_LEAVES = 0x02;
+
+// Largest payload of a binary frame
+const uint8_t HOST_FRAME_PAYLOAD_LENGTH = 16;
+
+bool isBinaryProtocol();
+void setBinaryProtocol(bool enabled);
+uint8_t getTelemetryMask();
+void setTelemetryMask(uint8_t mask);
+
+void sendHostEvent(HostEvent event);
+void sendMovementResult(MovementResult result);
+void sendHostFrame(uint8_t opcode, const uint8_t *payload, uint8_t length);
+const uint8_t *readHostFrame(uint8_t &length);
+uint8_t crc8(const uint8_t *data, uint8_t length);
+
+#endif // HOST_PROTOCOL_H
@@ -0,0 +1,25 @@
+/**
+ * @file        index_sequence.h
+ * @author      Simon Håkansson
+ * @date        2025-10-01
+ * @brief       Compile-time index lists for building constant tables.
+ *
+ * @details     A C++11 stand-in for std::index_sequence, which avr-gcc's
+ * library lacks. MakeIndexSequence<3>::type is IndexSequence<0, 1, 2>, so a
+ * constexpr function taking an IndexSequence<I...> can expand f(I)... into
+ * an array initializer.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+
+#ifndef INDEX_SEQUENCE_H
+#define INDEX_SEQUENCE_H
+
+template <int... I> struct IndexSequence {};
+template <int N, int... I> struct MakeIndexSequence : MakeIndexSequence<N - 1, N - 1, I...> {};
+template <int... I> struct MakeIndexSequence<0, I...> { typedef IndexSequence<I...> type; };
+
+#endif // INDEX_SEQUENCE_H
@@ -0,0 +1,149 @@
+/**
+ * @file        leaf_config.h
+ * @author      Simon Håkansson
+ * @date        2025-09-26
+ * @brief       Per-leaf configuration, generated at compile time into flash.
+ *
+ * @details     LEAF_PINS, LEAF_RANGES and LEAF_BASELINES in config.h are
+ * only read by the compiler. They are folded into one LeafConfig record per
+ * leaf, stored in PROGMEM so that none of it takes SRAM on the Uno. The
+ * mutable per-leaf state is kept elsewhere as plain arrays (phases in
+ * main.cpp, staged and sent pulses in servo_output.cpp), so the frame loop
+ * walks every array front to back.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+
+#ifndef LEAF_CONFIG_H
+#define LEAF_CONFIG_H
+
+#include <hal.h>
+#include <config.h>
+#include <index_sequence.h>
+#include <motion_kernel.h>
+#include <servo_calibration.h>
+
+//-------------[ LEAF RECORD ]-------------
+// Everything about a leaf that does not change while running
+struct LeafConfig {
+  int16_t trimTicksQ8;      // Servo trim, Q8 ticks
+  uint16_t minTicks;        // Pulse at the leaf's minimum angle, trim included
+  uint16_t maxTicks;        // Pulse at the leaf's maximum angle, trim included
+  float phaseStep;          // Phase advance per motion timestep at speedFactor 1
+  uint32_t initialPhase;    // Baseline phase offset (2^32 per turn)
+  uint16_t maxSlewTicksQ4;  // Largest pulse change per frame, Q4 ticks
+  uint8_t boardAddress;     // I2C address of the PCA9685
+  uint8_t channel;          // PCA9685 channel
+  uint8_t continuesBurst;   // 1 if on the channel after the previous leaf, same board
+};
+
+/**
+ * @brief  Converts radians to a binary angle at compile time.
+ *
+ * @param   radians The angle in radians, within one turn either way.
+ *
+ * @return  The angle in phase units, wrapped to one turn.
+ */
+constexpr uint32_t radiansToPhaseConstant(double radians) {
+  return (uint32_t)(int64_t)(radians * PHASE_UNITS_PER_RADIAN + 0.5);
+}
+
+/**
+ * @brief  Converts a slew-rate limit to the largest pulse change per frame.
+ *
+ * @param   degreesPerSecond The limit in degrees per second.
+ *
+ * @return  The limit in 1/16 tick steps per motion frame, at least 1.
+ */
+constexpr uint16_t slewToTicksQ4(double degreesPerSecond) {
+  return degreesToTicksQ8(degreesPerSecond / MOTION_FRAME_RATE_HZ) >= 16
+             ? degreesToTicksQ8(degreesPerSecond / MOTION_FRAME_RATE_HZ) >> 4
+             : 1;
+}
+
+/**
+ * @brief  Builds the flash record of one leaf.
+ *
+ * @param   leafIndex The index of the leaf.
+ *
+ * @return  The leaf's trim and limits, motion baseline, slew limit and wiring.
+ */
+constexpr LeafConfig makeLeafConfig(int leafIndex) {
+  return {
+    (int16_t)microsecondsToTicksQ8(LEAF_PINS[leafIndex].trimMicroseconds),
+    angleLimitToTicks(LEAF_RANGES[leafIndex].minAngle, LEAF_PINS[leafIndex].trimMicroseconds),
+    angleLimitToTicks(LEAF_RANGES[leafIndex].maxAngle, LEAF_PINS[leafIndex].trimMicroseconds),
+    (float)(LEAF_BASELINES[leafIndex].speed * MOTION_TIMESTEP_US / 1000000.0 * PHASE_UNITS_PER_RADIAN),
+    radiansToPhaseConstant(LEAF_BASELINES[leafIndex].phaseOffset),
+    slewToTicksQ4(LEAF_RANGES[leafIndex].maxSpeed),
+    LEAF_PINS[leafIndex].boardAddress,
+    LEAF_PINS[leafIndex].channel,
+    leafIndex > 0 && LEAF_PINS[leafIndex].boardAddress == LEAF_PINS[leafIndex - 1].boardAddress
+                  && LEAF_PINS[leafIndex].channel == LEAF_PINS[leafIndex - 1].channel + 1
+  };
+}
+
+struct LeafConfigTable {
+  LeafConfig leaves[NUM_LEAVES];
+};
+
+// Expands to makeLeafConfig(0), makeLeafConfig(1), ... at compile time
+template <int... I>
+constexpr LeafConfigTable buildLeafConfig(IndexSequence<I...>) {
+  return {{ makeLeafConfig(I)... }};
+}
+
+// Defined in leaf_config.cpp
+extern const LeafConfigTable LEAF_CONFIG PROGMEM;
+
+//-------------[ FLASH ACCESS ]-------------
+inline uint8_t getLeafBoard(uint8_t leafIndex) {
+  return pgm_read_byte(&LEAF_CONFIG.leaves[leafIndex].boardAddress);
+}
+
+inline uint8_t getLeafChannel(uint8_t leafIndex) {
+  return pgm_read_byte(&LEAF_CONFIG.leaves[leafIndex].channel);
+}
+
+inline bool doesLeafContinueBurst(uint8_t leafIndex) {
+  return pgm_read_byte(&LEAF_CONFIG.leaves[leafIndex].continuesBurst);
+}
+
+inline float getLeafPhaseStep(uint8_t leafIndex) {
+  return pgm_read_float(&LEAF_CONFIG.leaves[leafIndex].phaseStep);
+}
+
+inline uint32_t getLeafInitialPhase(uint8_t leafIndex) {
+  return pgm_read_dword(&LEAF_CONFIG.leaves[leafIndex].initialPhase);
+}
+
+inline uint16_t getLeafMaxSlew(uint8_t leafIndex) {
+  return pgm_read_word(&LEAF_CONFIG.leaves[leafIndex].maxSlewTicksQ4);
+}
+
+/**
+ * @brief  Maps a Q15 waveform sample to the PCA9685 off-tick of a leaf.
+ *
+ * @details The movement's center and amplitude apply to every leaf; the
+ * result is trimmed and then held within the leaf's safe range.
+ *
+ * @param   sample The waveform value in [-32767, 32767].
+ * @param   movement The active movement from calibrateMovement().
+ * @param   leafIndex The index of the leaf.
+ *
+ * @return  The tick count at which the servo pulse ends.
+ */
+inline uint16_t waveformToTicks(int16_t sample, const ServoCalibration &movement, uint8_t leafIndex) {
+  const LeafConfig &leaf = LEAF_CONFIG.leaves[leafIndex];
+  int32_t ticksQ8 = movement.midTicksQ8 + (((int32_t)sample * movement.halfSpanTicksQ8) >> 15)
+                    + (int16_t)pgm_read_word(&leaf.trimTicksQ8);
+  int32_t ticks = (ticksQ8 + 128) >> 8;
+  int32_t minTicks = pgm_read_word(&leaf.minTicks);
+  int32_t maxTicks = pgm_read_word(&leaf.maxTicks);
+  return constrain(ticks, minTicks, maxTicks);
+}
+
+#endif // LEAF_CONFIG_H
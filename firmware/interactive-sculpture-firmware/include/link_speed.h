@@ -0,0 +1,29 @@
+/**
+ * @file        link_speed.h
+ * @author      Simon Håkansson
+ * @date        2025-09-17
+ * @brief       Baud rate negotiation and fallback for the host link.
+ *
+ * @details     The link always boots at BAUD_RATE. The host then proposes a
+ * faster rate with "baud:<rate>". The firmware answers "baud:ack:<rate>" and
+ * switches, and the host must send "baud:confirm" at the new rate within
+ * BAUD_CONFIRM_TIMEOUT_MS, answered by "baud:ok". Without the confirmation,
+ * or when too many garbled messages arrive later, the firmware announces
+ * "baud:fallback", drops back to BAUD_RATE and the host renegotiates at a
+ * slower rate. A host that sees errors first sends "baud:reset" instead.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+
+#ifndef LINK_SPEED_H
+#define LINK_SPEED_H
+
+void updateLinkSpeed();
+void handleBaudCommand(int value, const char *arguments);
+void reportLinkError();
+unsigned long getLinkBaudRate();
+
+#endif // LINK_SPEED_H
@@ -0,0 +1,59 @@
+/**
+ * @file        loop_profiler.h
+ * @author      Simon Håkansson
+ * @date        2025-09-24
+ * @brief       Per-subsystem loop timing with log2 histograms.
+ *
+ * @details     Wrap a call in PROFILE() to time it with micros() and count
+ * the duration in that section's histogram. Bucket 0 counts 0 us, and
+ * bucket b counts durations from 2^(b-1) to 2^b - 1 us; the last bucket
+ * also takes anything longer. The "stats" serial command prints the
+ * histograms and starts a new measurement window.
+ *
+ *              Only built when LOOP_PROFILING is defined (the uno_profile
+ *              environment). Otherwise PROFILE() expands to the bare
+ *              statement and nothing is linked in.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+
+#ifndef LOOP_PROFILER_H
+#define LOOP_PROFILER_H
+
+// The parts of loop() that are timed
+enum ProfileSection {
+  PROFILE_LOOP,     // The whole loop() pass
+  PROFILE_LEAVES,   // updateLeafMovement()
+  PROFILE_SENSORS,  // userDetection()
+  PROFILE_SERIAL,   // readSerialCommands()
+  PROFILE_LINK,     // updateLinkSpeed()
+  PROFILE_STORE,    // updateMovementStore()
+  NUM_PROFILE_SECTIONS
+};
+
+#ifdef LOOP_PROFILING
+
+#include <hal.h>
+
+const uint8_t PROFILE_HISTOGRAM_BUCKETS = 16; // Up to 16 ms and over
+
+void recordProfileSample(ProfileSection section, unsigned long duration);
+void printProfileStats();
+
+#define PROFILE(section, statement)                         \
+  do {                                                      \
+    unsigned long profileStart = micros();                  \
+    statement;                                              \
+    recordProfileSample(section, micros() - profileStart);  \
+  } while (0)
+
+#else
+
+#define PROFILE(section, statement) statement
+
+#endif // LOOP_PROFILING
+
+#endif // LOOP_PROFILER_H
@@ -0,0 +1,31 @@
+/**
+ * @file        motion_kernel.h
+ * @author      Simon Håkansson
+ * @date        2025-09-04
+ * @brief       Fixed-point waveform kernel for the leaf animation.
+ *
+ * @details     Phases are 32-bit binary angles where a full turn is 2^32, so
+ * they wrap for free on overflow. The sine and the other waveforms are read
+ * from Q15 tables in flash and linearly interpolated, which avoids soft-float
+ * sin() on the ATmega328P.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+
+#ifndef MOTION_KERNEL_H
+#define MOTION_KERNEL_H
+
+#include <stdint.h>
+#include <config.h>
+
+// Binary angle units in one radian (2^32 / 2 PI)
+constexpr float PHASE_UNITS_PER_RADIAN = 683565275.6;
+
+int16_t sineQ15(uint32_t phase);
+int16_t evaluateWaveform(WaveformId waveform, uint32_t phase);
+uint32_t radiansToPhase(float radians);
+
+#endif // MOTION_KERNEL_H
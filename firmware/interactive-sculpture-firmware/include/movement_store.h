@@ -0,0 +1,32 @@
+/**
+ * @file        movement_store.h
+ * @author      Simon Håkansson
+ * @date        2025-10-03
+ * @brief       Movement sets the host can replace at runtime, kept in EEPROM.
+ *
+ * @details     Two banks of movement sets are held in RAM. Uploads from the
+ * host are validated and written to the staged bank only. Activation copies
+ * the staged bank over the active one in a single step, so the animation
+ * never sees a half-uploaded set. The active bank is then saved to EEPROM in
+ * the background, one byte per call to updateMovementStore().
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+
+#ifndef MOVEMENT_STORE_H
+#define MOVEMENT_STORE_H
+
+#include <config.h>
+
+void loadMovementSets();
+const MovementSet &getMovementSet(MovementState state);
+bool isValidMovementSet(const MovementSet &movement);
+bool stageMovementSet(MovementState state, const MovementSet &movement);
+void stageDefaultMovementSets();
+void activateMovementSets();
+void updateMovementStore();
+
+#endif // MOVEMENT_STORE_H
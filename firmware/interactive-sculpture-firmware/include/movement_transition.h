@@ -0,0 +1,37 @@
+/**
+ * @file        movement_transition.h
+ * @author      Simon Håkansson
+ * @date        2025-09-29
+ * @brief       Eased cross-fades between movement sets and servo slew limits.
+ *
+ * @details     A change of movement state does not switch the animation
+ * parameters at once. Amplitude, center angle and speed factor are blended
+ * from wherever they are towards the new set over MOVEMENT_TRANSITION_MS,
+ * following MOVEMENT_TRANSITION_EASING, and a new waveform is cross-faded
+ * over the old one. A state change in the middle of a transition blends on
+ * from the current values. Only two waveforms are ever mixed, so a waveform
+ * fade that is still running finishes before the next one starts.
+ *
+ *              Independently, every servo pulse goes through a per-leaf
+ *              slew-rate limit (LEAF_RANGES maxSpeed), which caps how far a
+ *              servo can be asked to move in one frame whatever the cause.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+
+#ifndef MOVEMENT_TRANSITION_H
+#define MOVEMENT_TRANSITION_H
+
+#include <config.h>
+
+void setActiveMovement(const MovementSet &movement);
+void startMovementTransition(const MovementSet &target);
+bool updateMovementTransition();
+const MovementSet &getActiveMovement();
+int16_t sampleActiveWaveform(uint32_t phase);
+uint16_t limitServoSlew(uint8_t leafIndex, uint16_t ticks);
+
+#endif // MOVEMENT_TRANSITION_H
@@ -0,0 +1,47 @@
+/**
+ * @file        serial_commands.h
+ * @author      Simon Håkansson
+ * @date        2025-09-12
+ * @brief       Non-blocking, allocation-free serial command parser.
+ *
+ * @details     Bytes from the host are collected into a fixed line buffer as
+ * they arrive and a completed line is looked up in a command table stored in
+ * flash. Nothing ever waits for the rest of a line, and no String is built.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+
+#ifndef SERIAL_COMMANDS_H
+#define SERIAL_COMMANDS_H
+
+#include <stdint.h>
+
+// Longest command line accepted from the host, without the newline
+const uint8_t SERIAL_LINE_LENGTH = 48;
+
+// Room for the longest command name in the table, with its terminator
+const uint8_t SERIAL_COMMAND_NAME_LENGTH = 28;
+
+// Bytes consumed per call, which bounds the time spent parsing per loop()
+const uint8_t SERIAL_BYTES_PER_POLL = 64;
+
+// A command handler gets the entry's value and the text after a prefix match
+typedef void (*CommandHandler)(int value, const char *arguments);
+
+// One entry of a command table. A name ending in ':' matches any line that
+// starts with it, everything else must match the whole line. The value is
+// 16 bits wide on every build, so it is read from flash as one word.
+struct SerialCommand {
+  char name[SERIAL_COMMAND_NAME_LENGTH];
+  CommandHandler handler;
+  int16_t value;
+};
+
+const char *readSerialLine();
+bool dispatchSerialCommand(const char *line, const SerialCommand *commands, uint8_t count);
+bool parseNumberList(const char *text, float *values, uint8_t count);
+
+#endif // SERIAL_COMMANDS_H
@@ -0,0 +1,105 @@
+/**
+ * @file        servo_calibration.h
+ * @author      Simon Håkansson
+ * @date        2025-09-05
+ * @brief       Compile-time servo calibration for the leaf animation.
+ *
+ * @details     Folds the angle-to-pulse map (SERVO_MAX_ANGLE,
+ * PULSEWIDTH_MIN/MAX) into fixed-point PCA9685 tick values. A movement's
+ * center and amplitude become one midpoint and half-span shared by all
+ * leaves, computed when the movement changes. Per-leaf trims and angle
+ * limits are evaluated by the compiler; leaf_config.h stores them in flash.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+
+#ifndef SERVO_CALIBRATION_H
+#define SERVO_CALIBRATION_H
+
+#include <hal.h>
+#include <config.h>
+
+//-------------[ PCA9685 TIMING ]-------------
+// Prescaler the Adafruit driver programs for SERVO_FREQUENCY
+constexpr int32_t PCA9685_PRESCALE =
+    (int32_t)((double)PCA9685_OSCILLATOR_FREQUENCY / (SERVO_FREQUENCY * 4096.0) + 0.5) - 1;
+
+/**
+ * @brief  Converts a pulse width to PCA9685 ticks in Q8 fixed point.
+ *
+ * @param   microseconds Pulse width in microseconds.
+ *
+ * @return  The pulse width in 1/256 tick steps.
+ */
+constexpr int32_t microsecondsToTicksQ8(double microseconds) {
+  return (int32_t)(microseconds * PCA9685_OSCILLATOR_FREQUENCY / ((PCA9685_PRESCALE + 1) * 1000000.0) * 256.0 + 0.5);
+}
+
+/**
+ * @brief  Converts a servo angle to its pulse width in microseconds.
+ *
+ * @param   angle Servo angle in degrees.
+ *
+ * @return  The pulse width in microseconds.
+ */
+constexpr double angleToMicroseconds(double angle) {
+  return PULSEWIDTH_MIN + angle * (PULSEWIDTH_MAX - PULSEWIDTH_MIN) / SERVO_MAX_ANGLE;
+}
+
+/**
+ * @brief  Converts an angle difference to the pulse difference in Q8 ticks.
+ *
+ * @param   degrees The change in servo angle.
+ *
+ * @return  The matching change of pulse width in 1/256 tick steps.
+ */
+constexpr int32_t degreesToTicksQ8(double degrees) {
+  return microsecondsToTicksQ8(degrees * (PULSEWIDTH_MAX - PULSEWIDTH_MIN) / SERVO_MAX_ANGLE);
+}
+
+/**
+ * @brief  Converts a leaf's angle limit to a pulse in whole ticks.
+ *
+ * @param   angle The limit in degrees.
+ * @param   trimMicroseconds The servo's trim.
+ *
+ * @return  The trimmed pulse at that angle in PCA9685 ticks.
+ */
+constexpr uint16_t angleLimitToTicks(double angle, int trimMicroseconds) {
+  return (microsecondsToTicksQ8(angleToMicroseconds(angle) + trimMicroseconds) + 128) >> 8;
+}
+
+//-------------[ MOVEMENT CALIBRATION ]-------------
+// Output of the sine at its midpoint and half its swing, in Q8 ticks
+struct ServoCalibration {
+  int32_t midTicksQ8;
+  int32_t halfSpanTicksQ8;
+};
+
+/**
+ * @brief  Converts a movement's center and amplitude to pulse coefficients.
+ *
+ * @details Runs when the active movement changes, not per frame. The
+ * amplitude is limited to half the servo's travel, which is all any leaf
+ * could use and keeps the waveform product within 32 bits.
+ *
+ * @param   centerAngle The midpoint of the movement in degrees.
+ * @param   amplitude The swing either side of the midpoint in degrees.
+ *
+ * @return  The midpoint and half-span in Q8 ticks, without trim.
+ */
+inline ServoCalibration calibrateMovement(float centerAngle, float amplitude) {
+  return {
+    microsecondsToTicksQ8(angleToMicroseconds(centerAngle)),
+    degreesToTicksQ8(constrain(amplitude, 0.0f, SERVO_MAX_ANGLE / 2.0f))
+  };
+}
+
+// The Q15 product in waveformToTicks() only fits in 32 bits for half-spans under 256 ticks
+static_assert(microsecondsToTicksQ8((PULSEWIDTH_MAX - PULSEWIDTH_MIN) / 2.0) < (256L << 8),
+              "Servo pulse range too wide for the Q8 calibration");
+
+#endif // SERVO_CALIBRATION_H
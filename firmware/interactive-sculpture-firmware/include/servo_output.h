@@ -0,0 +1,29 @@
+/**
+ * @file        servo_output.h
+ * @author      Simon Håkansson
+ * @date        2025-09-08
+ * @brief       Batched PCA9685 output stage for the leaf servos.
+ *
+ * @details     Servo positions are staged in a frame buffer of off-ticks and
+ * sent to the PCA9685 in auto-increment bursts, one frame at a time, instead
+ * of one I2C transaction per servo. Channels whose
+ * pulse has not changed since the last write are left off the bus. Leaves
+ * are addressed by index; LEAF_PINS maps them to a board and channel.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+
+#ifndef SERVO_OUTPUT_H
+#define SERVO_OUTPUT_H
+
+#include <stdint.h>
+
+void initializeServoOutput();
+void setServoTicks(uint8_t leafIndex, uint16_t ticks);
+void flushServoFrame();
+unsigned long getSkippedServoWrites();
+
+#endif // SERVO_OUTPUT_H
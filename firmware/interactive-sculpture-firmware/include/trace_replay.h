@@ -0,0 +1,27 @@
+/**
+ * @file        trace_replay.h
+ * @author      Simon Håkansson
+ * @date        2025-09-19
+ * @brief       Replay of recorded sensor distances in the native build.
+ *
+ * @details     A trace is a CSV file of time_ms,approach_cm,interaction_cm
+ * rows in time order, timed from when the trace is opened. Each row sets
+ * both simulated sensor distances from its time on; an empty, zero or non-numeric distance means no echo. Lines
+ * that do not start with a digit, such as a header, are skipped. Only
+ * available when ARDUINO is not defined.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+
+#ifndef TRACE_REPLAY_H
+#define TRACE_REPLAY_H
+
+bool openTrace(const char *path);
+bool updateTrace();
+unsigned long getTraceRows();
+void closeTrace();
+
+#endif // TRACE_REPLAY_H
@@ -0,0 +1,33 @@
+/**
+ * @file        ultrasonic.h
+ * @author      Simon Håkansson
+ * @date        2025-09-02
+ * @brief       Non-blocking ultrasonic ranging engine for the interactive sculpture.
+ *
+ * @details     Pings are started from the main loop and return immediately.
+ * The echo pulse is timed by pin-change interrupts, so the main loop never
+ * waits on a sensor the way pulseIn() does. Sensors are pinged in the ping
+ * slots set in ULTRASONIC_SENSORS, several at a time. A complete set of
+ * distances is published once every sensor has either answered or timed out.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+
+#ifndef ULTRASONIC_H
+#define ULTRASONIC_H
+
+#include <math.h>
+#include <config.h>
+
+// Distance reported when no echo came back from within the sensor's range.
+// It compares as farther than any threshold.
+const float ULTRASONIC_OUT_OF_RANGE_CM = INFINITY;
+
+void initializeUltrasonicSensors();
+bool updateUltrasonicRanging();
+float getUltrasonicDistance(SensorType sensor);
+
+#endif // ULTRASONIC_H
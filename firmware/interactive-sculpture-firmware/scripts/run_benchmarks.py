@@ -0,0 +1,143 @@
+"""
+@file       run_benchmarks.py
+@author     Simon Håkansson
+@date       2025-09-22
+@brief      Runs the firmware cycle-count benchmarks under simavr.
+
+@details    Build the bench environment first, then run this script:
+
+                pio run -e bench
+                python scripts/run_benchmarks.py --output bench.json
+
+            The firmware prints one "bench:" JSON line (see benchmark.h) and
+            halts, which ends the simulation. The result is written as JSON
+            with the git revision added. Given --baseline, every function's
+            average and maximum cycle count and the SRAM peak are compared
+            with an earlier result, and the script exits with status 1 if any
+            of them grew by more than --tolerance. A frame that does not fit in
+            the motion frame period fails the run on its own.
+
+            The native_bench environment prints the same JSON, in simulated
+            time, from a host program:
+
+                pio run -e native_bench
+                python scripts/run_benchmarks.py --native .pio/build/native_bench/program
+
+@copyright  Copyright (c) 2025 Simon Håkansson
+
+This software is released under the MIT License.
+See the LICENSE file in the project root for the full license text.
+"""
+
+# -------------[ LIBRARIES ]-------------
+import argparse
+import json
+import re
+import subprocess
+import sys
+
+# -------------[ CONSTANTS ]-------------
+DEFAULT_ELF = ".pio/build/bench/firmware.elf"
+SIMAVR_TIMEOUT = 120  # seconds
+ANSI_ESCAPE = re.compile(r"\x1b\[[0-9;]*m")
+
+
+# -------------[ FUNCTIONS ]-------------
+def run_benchmark(command):
+    """Runs a benchmark build and returns the parsed "bench:" result."""
+    completed = subprocess.run(command,
+                               stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                               timeout=SIMAVR_TIMEOUT, text=True, errors="replace")
+    output = ANSI_ESCAPE.sub("", completed.stdout)
+
+    start = output.find("bench:")
+    if start < 0:
+        sys.exit("No benchmark result in the output:\n" + output)
+
+    # simavr may break long UART lines, so join them before decoding
+    text = output[start + len("bench:"):].replace("\r", "").replace("\n", "")
+    result, _ = json.JSONDecoder().raw_decode(text)
+    return result
+
+
+def git_revision():
+    """Returns the current git revision, or None outside a repository."""
+    try:
+        return subprocess.check_output(["git", "describe", "--always", "--dirty"],
+                                       text=True, stderr=subprocess.DEVNULL).strip()
+    except (OSError, subprocess.CalledProcessError):
+        return None
+
+
+def find_regressions(result, baseline, tolerance):
+    """Lists the measurements that grew by more than tolerance over baseline."""
+    regressions = []
+
+    def check(name, new, old):
+        if old and new > old * (1 + tolerance):
+            regressions.append(f"{name}: {old} -> {new} (+{(new - old) * 100 / old:.1f}%)")
+
+    for function, stats in result["functions"].items():
+        old = baseline.get("functions", {}).get(function)
+        if old:
+            check(f"{function} avg cycles", stats["avg"], old["avg"])
+            check(f"{function} max cycles", stats["max"], old["max"])
+
+    if "sram" in result and "sram" in baseline:
+        check("SRAM peak bytes", result["sram"]["peak"], baseline["sram"]["peak"])
+
+    return regressions
+
+
+def find_budget_overruns(result):
+    """Lists the limits the result breaks regardless of any baseline."""
+    overruns = []
+
+    frame = result["functions"].get("updateLeafMovement")
+    if frame and frame["max"] > result["frame_budget"]:
+        overruns.append(f"a {result['leaves']}-leaf frame takes {frame['max']} cycles, "
+                        f"the frame period is {result['frame_budget']}")
+
+    if "sram" in result and result["sram"]["peak"] > result["sram"]["total"]:
+        overruns.append(f"SRAM peak of {result['sram']['peak']} bytes exceeds {result['sram']['total']}")
+
+    return overruns
+
+
+# -------------[ MAIN ]-------------
+def main():
+    parser = argparse.ArgumentParser(description="Run the firmware benchmarks under simavr.")
+    parser.add_argument("--elf", default=DEFAULT_ELF, help="firmware image built by the bench environment")
+    parser.add_argument("--simavr", default="simavr", help="simavr executable")
+    parser.add_argument("--native", help="native benchmark program to run instead of simavr")
+    parser.add_argument("--output", help="file to write the JSON result to, stdout if omitted")
+    parser.add_argument("--baseline", help="earlier result to compare against")
+    parser.add_argument("--tolerance", type=float, default=0.05,
+                        help="allowed relative growth before a regression is reported")
+    args = parser.parse_args()
+
+    if args.native:
+        result = run_benchmark([args.native])
+    else:
+        result = run_benchmark([args.simavr, "-m", "atmega328p", "-f", "16000000", args.elf])
+    result["revision"] = git_revision()
+
+    text = json.dumps(result, indent=2)
+    if args.output:
+        with open(args.output, "w") as file:
+            file.write(text + "\n")
+    else:
+        print(text)
+
+    failures = find_budget_overruns(result)
+    if args.baseline:
+        with open(args.baseline) as file:
+            failures += find_regressions(result, json.load(file), args.tolerance)
+    for failure in failures:
+        print("Failed: " + failure, file=sys.stderr)
+    if failures:
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,244 @@
+/**
+ * @file        benchmark.cpp
+ * @author      Simon Håkansson
+ * @date        2025-09-22
+ * @brief       Cycle-count benchmarks for the ATmega328P, run under simavr.
+ *
+ * @details     Output format, on one line:
+ *
+ *              bench:{"clock":"cpu","f_cpu":16000000,"leaves":2,
+ *              "frame_budget":320000,"functions":{"moveLeaf":{"calls":200,
+ *              "min":...,"avg":...,"max":...},...},"sram":{"static":...,
+ *              "stack_peak":...,"peak":...,"total":2048}}
+ *
+ *              Cycle counts have the cost of the measurement itself removed.
+ *              frame_budget is the cycles in one motion frame period. The
+ *              native build reports "clock":"simulated" and leaves out sram.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+#ifdef BENCHMARK
+
+//-------------[ LIBRARIES ]-------------
+#include <benchmark.h>
+#include <config.h>
+#ifdef __AVR__
+#include <avr/sleep.h>
+#else
+#include <stdio.h>
+#endif
+
+//-------------[ INITIALIZATION ]-------------
+#ifdef __AVR__
+// Fill pattern for unused SRAM
+const uint8_t STACK_PAINT = 0xC5;
+
+// Linker symbols for the end of .bss and the top of the stack
+extern uint8_t _end;
+extern uint8_t __stack;
+
+// Upper 16 bits of the cycle counter, Timer1 holds the lower 16
+static volatile uint16_t cycleOverflows = 0;
+#endif
+
+// Cycles spent timing an empty function
+static uint32_t measurementOverhead = 0;
+
+static bool firstResult = true;
+
+//-------------[ FUNCTION PROTOTYPES ]-------------
+static uint32_t readCycleCounter();
+static void emptyFunction();
+#ifdef __AVR__
+static uint16_t getStackPeak();
+
+//-------------[ STACK PAINTING ]-------------
+/**
+ * @brief  Paints free SRAM before the C runtime sets anything up.
+ *
+ * @details Runs from .init1, before the stack pointer is usable, so it is
+ * written in assembly and touches no stack.
+ */
+void paintStack() __attribute__((naked, used, section(".init1")));
+void paintStack() {
+  __asm volatile(
+      "    ldi r30, lo8(_end)\n"
+      "    ldi r31, hi8(_end)\n"
+      "    ldi r24, %0\n"
+      "    ldi r25, hi8(__stack)\n"
+      "    rjmp 2f\n"
+      "1:  st Z+, r24\n"
+      "2:  cpi r30, lo8(__stack)\n"
+      "    cpc r31, r25\n"
+      "    brlo 1b\n"
+      "    breq 1b\n"
+      :
+      : "i"(STACK_PAINT));
+}
+#endif
+
+//-------------[ PUBLIC FUNCTIONS ]-------------
+/**
+ * @brief  Starts the cycle counter and measures its own overhead.
+ */
+void initializeBenchmark() {
+#ifdef __AVR__
+  TCCR1A = 0;
+  TCCR1B = _BV(CS10); // No prescaler, one count per CPU cycle
+  TCNT1 = 0;
+  TIFR1 = _BV(TOV1);
+  TIMSK1 = _BV(TOIE1);
+#endif
+
+  uint32_t fastest = UINT32_MAX;
+  for (uint8_t i = 0; i < 16; i++) {
+    uint32_t start = readCycleCounter();
+    emptyFunction();
+    uint32_t cycles = readCycleCounter() - start;
+    fastest = min(fastest, cycles);
+  }
+  measurementOverhead = fastest;
+
+#ifdef __AVR__
+  Serial.print(F("bench:{\"clock\":\"cpu\",\"f_cpu\":"));
+#else
+  Serial.print(F("bench:{\"clock\":\"simulated\",\"f_cpu\":"));
+#endif
+  Serial.print(F_CPU);
+  Serial.print(F(",\"leaves\":"));
+  Serial.print(NUM_LEAVES);
+  Serial.print(F(",\"frame_budget\":"));
+  Serial.print(F_CPU / MOTION_FRAME_RATE_HZ);
+  Serial.print(F(",\"functions\":{"));
+}
+
+/**
+ * @brief  Times a function and prints its cycle statistics.
+ *
+ * @param   name The name reported in the JSON output.
+ * @param   function The function to time.
+ * @param   iterations Number of timed calls.
+ * @param   settleMicros Untimed wait before each call, for functions that only
+ *          do work once their interval has passed.
+ */
+void benchmarkFunction(const __FlashStringHelper *name, BenchmarkFunction function,
+                       uint16_t iterations, unsigned long settleMicros) {
+  uint32_t fastest = UINT32_MAX;
+  uint32_t slowest = 0;
+  uint32_t total = 0;
+
+  for (uint16_t i = 0; i < iterations; i++) {
+    if (settleMicros) {
+      delayMicroseconds(settleMicros % 1000);
+      delay(settleMicros / 1000);
+    }
+
+    uint32_t start = readCycleCounter();
+    function();
+    uint32_t cycles = readCycleCounter() - start;
+    cycles = cycles > measurementOverhead ? cycles - measurementOverhead : 0;
+
+    fastest = min(fastest, cycles);
+    slowest = max(slowest, cycles);
+    total += cycles;
+  }
+
+  Serial.print(firstResult ? F("\"") : F(",\""));
+  firstResult = false;
+  Serial.print(name);
+  Serial.print(F("\":{\"calls\":"));
+  Serial.print(iterations);
+  Serial.print(F(",\"min\":"));
+  Serial.print(fastest);
+  Serial.print(F(",\"avg\":"));
+  Serial.print(total / iterations);
+  Serial.print(F(",\"max\":"));
+  Serial.print(slowest);
+  Serial.print('}');
+}
+
+/**
+ * @brief  Prints the SRAM usage, closes the JSON line and stops the CPU.
+ *
+ * @details Sleeping with interrupts disabled makes simavr exit. On real
+ * hardware the board simply halts, and the native build exits.
+ */
+void finishBenchmark() {
+#ifdef __AVR__
+  uint16_t staticBytes = &_end - (uint8_t *)RAMSTART;
+  uint16_t stackPeak = getStackPeak();
+
+  Serial.print(F("},\"sram\":{\"static\":"));
+  Serial.print(staticBytes);
+  Serial.print(F(",\"stack_peak\":"));
+  Serial.print(stackPeak);
+  Serial.print(F(",\"peak\":"));
+  Serial.print(staticBytes + stackPeak);
+  Serial.print(F(",\"total\":"));
+  Serial.print(RAMEND - RAMSTART + 1);
+  Serial.println(F("}}"));
+  Serial.flush();
+
+  cli();
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  sleep_enable();
+  sleep_cpu();
+#else
+  Serial.println(F("}}"));
+  fflush(stdout);
+  exit(0);
+#endif
+}
+
+//-------------[ HELPER FUNCTIONS ]-------------
+/**
+ * @brief  Reads the 32-bit cycle counter.
+ *
+ * @details An overflow that is pending but not yet counted by the ISR is
+ * accounted for here, so the counter never steps backwards.
+ */
+static uint32_t readCycleCounter() {
+#ifdef __AVR__
+  uint8_t oldSREG = SREG;
+  cli();
+  uint16_t low = TCNT1;
+  uint16_t high = cycleOverflows;
+  if ((TIFR1 & _BV(TOV1)) && low < 0x8000) {
+    high++;
+  }
+  SREG = oldSREG;
+  return ((uint32_t)high << 16) | low;
+#else
+  return simMicros() * (F_CPU / 1000000UL);
+#endif
+}
+
+/**
+ * @brief  Calibrates the cost of a timed call.
+ */
+static void __attribute__((noinline)) emptyFunction() {
+  __asm volatile("");
+}
+
+#ifdef __AVR__
+/**
+ * @brief  Finds the deepest point the stack has reached since reset.
+ *
+ * @return  The peak stack use in bytes.
+ */
+static uint16_t getStackPeak() {
+  const uint8_t *p = &_end;
+  while (p <= &__stack && *p == STACK_PAINT) {
+    p++;
+  }
+  return &__stack - p + 1;
+}
+
+//-------------[ INTERRUPT VECTORS ]-------------
+ISR(TIMER1_OVF_vect) { cycleOverflows++; }
+#endif
+
+#endif // BENCHMARK
@@ -0,0 +1,140 @@
+/**
+ * @file        distance_filter.cpp
+ * @author      Simon Håkansson
+ * @date        2025-10-06
+ * @brief       Outlier gate, running median and moving average for sensor distances.
+ *
+ * @details     Each reading runs through three stages. The rate gate drops
+ * a reading that jumps further than DISTANCE_MAX_STEP_MM from the last
+ * accepted one, until DISTANCE_STEP_CONFIRMATIONS readings in a row agree
+ * on the new distance, each within DISTANCE_MAX_STEP_MM of the first.
+ * The median of the last DISTANCE_MEDIAN_WINDOW accepted readings removes
+ * what is left of the noise, and an exponential moving average smooths the
+ * steps between medians. Out-of-range readings pass through as their own
+ * value, DISTANCE_OUT_OF_RANGE_MM, and are never averaged with distances.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+//-------------[ LIBRARIES ]-------------
+#include <hal.h>
+#include <config.h>
+#include <distance_filter.h>
+#include <ultrasonic.h>
+
+//-------------[ INITIALIZATION ]-------------
+static_assert(DISTANCE_MEDIAN_WINDOW % 2 == 1, "DISTANCE_MEDIAN_WINDOW must be odd");
+
+// The state of one sensor's filter
+struct DistanceFilter {
+  uint16_t window[DISTANCE_MEDIAN_WINDOW]; // Last accepted readings, a ring
+  uint8_t next;                            // Ring slot the next reading goes to
+  uint8_t rejections;                      // Readings dropped by the gate in a row
+  uint16_t candidate;                      // First of the dropped readings
+  uint16_t accepted;                       // Last reading through the gate
+  uint16_t average;                        // Moving average of the medians
+  bool primed;                             // False until the first reading
+};
+
+// Indexed by SensorType
+static DistanceFilter distanceFilters[NUM_ULTRASONIC_SENSORS];
+
+//-------------[ FUNCTION PROTOTYPES ]-------------
+static uint16_t getWindowMedian(const DistanceFilter &filter);
+static uint16_t getDistanceStep(uint16_t a, uint16_t b);
+
+//-------------[ PUBLIC FUNCTIONS ]-------------
+/**
+ * @brief  Converts a published reading to the filter's millimeters.
+ *
+ * @param   distanceCm The reading in cm, or ULTRASONIC_OUT_OF_RANGE_CM.
+ *
+ * @return  The reading in mm, DISTANCE_OUT_OF_RANGE_MM if out of range.
+ */
+uint16_t distanceToMillimeters(float distanceCm) {
+  return distanceCm * 10 < DISTANCE_OUT_OF_RANGE_MM
+      ? (uint16_t)(distanceCm * 10) : DISTANCE_OUT_OF_RANGE_MM;
+}
+
+/**
+ * @brief  Adds a reading to a sensor's filter and returns the filtered distance.
+ *
+ * @details The first reading fills the whole window, so the filter gives a
+ * usable value from the start.
+ *
+ * @param   sensor The sensor the reading is from.
+ * @param   reading The reading in mm, or DISTANCE_OUT_OF_RANGE_MM.
+ *
+ * @return  The filtered distance in mm, or DISTANCE_OUT_OF_RANGE_MM.
+ */
+uint16_t filterDistance(SensorType sensor, uint16_t reading) {
+  DistanceFilter &filter = distanceFilters[sensor];
+
+  if (!filter.primed) {
+    for (uint8_t i = 0; i < DISTANCE_MEDIAN_WINDOW; i++) {
+      filter.window[i] = reading;
+    }
+    filter.accepted = reading;
+    filter.average = reading;
+    filter.primed = true;
+  }
+
+  // Rate gate: a jump has to repeat before it is believed. Readings that
+  // jump somewhere else start the count again.
+  if (getDistanceStep(reading, filter.accepted) > DISTANCE_MAX_STEP_MM) {
+    if (filter.rejections == 0 || getDistanceStep(reading, filter.candidate) > DISTANCE_MAX_STEP_MM) {
+      filter.candidate = reading;
+      filter.rejections = 0;
+    }
+    if (++filter.rejections < DISTANCE_STEP_CONFIRMATIONS) {
+      return filter.average;
+    }
+  }
+  filter.rejections = 0;
+  filter.accepted = reading;
+
+  // Running median of the accepted readings
+  filter.window[filter.next] = reading;
+  filter.next = (filter.next + 1) % DISTANCE_MEDIAN_WINDOW;
+  uint16_t median = getWindowMedian(filter);
+
+  // Moving average, restarted whenever the median enters or leaves the range
+  if (median == DISTANCE_OUT_OF_RANGE_MM || filter.average == DISTANCE_OUT_OF_RANGE_MM) {
+    filter.average = median;
+  } else {
+    filter.average += ((int32_t)median - filter.average) * DISTANCE_EMA_WEIGHT_Q8 / 256;
+  }
+
+  return filter.average;
+}
+
+//-------------[ HELPER FUNCTIONS ]-------------
+/**
+ * @brief  Returns the median of a filter's window.
+ *
+ * @details Insertion-sorts a copy of the window, which for a handful of
+ * readings is cheaper than keeping it sorted.
+ */
+static uint16_t getWindowMedian(const DistanceFilter &filter) {
+  uint16_t sorted[DISTANCE_MEDIAN_WINDOW];
+
+  for (uint8_t i = 0; i < DISTANCE_MEDIAN_WINDOW; i++) {
+    uint16_t value = filter.window[i];
+    uint8_t j = i;
+    for (; j > 0 && sorted[j - 1] > value; j--) {
+      sorted[j] = sorted[j - 1];
+    }
+    sorted[j] = value;
+  }
+
+  return sorted[DISTANCE_MEDIAN_WINDOW / 2];
+}
+
+/**
+ * @brief  Returns how far apart two readings are.
+ */
+static uint16_t getDistanceStep(uint16_t a, uint16_t b) {
+  return a > b ? a - b : b - a;
+}
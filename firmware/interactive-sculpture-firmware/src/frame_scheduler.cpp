@@ -0,0 +1,108 @@
+/**
+ * @file        frame_scheduler.cpp
+ * @author      Simon Håkansson
+ * @date        2025-09-10
+ * @brief       Fixed-rate scheduler for leaf motion frames.
+ *
+ * @details     Deadlines advance by exactly one period each frame so the rate
+ * does not drift with loop() timing. Jitter is how late a frame starts after
+ * its deadline. A frame that starts a whole period late counts as an overrun
+ * and the schedule restarts from the current time rather than bursting to
+ * catch up.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+//-------------[ LIBRARIES ]-------------
+#include <hal.h>
+#include <config.h>
+#include <frame_scheduler.h>
+#include <servo_output.h>
+
+//-------------[ INITIALIZATION ]-------------
+// Time between motion frames
+const unsigned long MOTION_FRAME_PERIOD_US = 1000000UL / MOTION_FRAME_RATE_HZ;
+
+// Deadline of the next frame
+static unsigned long nextFrameTime = 0;
+
+// Frame jitter statistics, in microseconds
+static unsigned long frameCount = 0;
+static unsigned long frameOverruns = 0;
+static unsigned long frameJitterTotal = 0;
+static unsigned long frameJitterMin = 0xFFFFFFFF;
+static unsigned long frameJitterMax = 0;
+
+//-------------[ PUBLIC FUNCTIONS ]-------------
+/**
+ * @brief  Starts the frame schedule from the current time.
+ */
+void initializeFrameScheduler() {
+  nextFrameTime = micros();
+}
+
+/**
+ * @brief  Checks whether the next motion frame is due.
+ *
+ * @details Call this every loop() pass. On the call that returns true the
+ * frame's jitter is recorded and the next deadline is scheduled.
+ *
+ * @return  True if a frame should be computed and sent now.
+ */
+bool isMotionFrameDue() {
+  unsigned long now = micros();
+  if ((long)(now - nextFrameTime) < 0) {
+    return false; // Not time for a frame yet
+  }
+
+  // Record how late this frame is
+  unsigned long jitter = now - nextFrameTime;
+  frameCount++;
+  frameJitterTotal += jitter;
+  if (jitter < frameJitterMin) {
+    frameJitterMin = jitter;
+  }
+  if (jitter > frameJitterMax) {
+    frameJitterMax = jitter;
+  }
+
+  // Schedule the next frame, restarting the schedule after an overrun
+  nextFrameTime += MOTION_FRAME_PERIOD_US;
+  if (jitter >= MOTION_FRAME_PERIOD_US) {
+    frameOverruns++;
+    nextFrameTime = now + MOTION_FRAME_PERIOD_US;
+  }
+
+  return true;
+}
+
+/**
+ * @brief  Sends the frame jitter statistics to the host and starts a new window.
+ *
+ * @details Also reports the servo writes the output stage left out because
+ * the pulse had not changed. The jitter statistics are cleared afterwards,
+ * so each report covers the time since the last one and the jitter total
+ * cannot overflow over a long run.
+ */
+void printFrameStats() {
+  Serial.print(F("stats:frames count="));
+  Serial.print(frameCount);
+  Serial.print(F(" overruns="));
+  Serial.print(frameOverruns);
+  Serial.print(F(" jitter_min_us="));
+  Serial.print(frameCount > 0 ? frameJitterMin : 0);
+  Serial.print(F(" jitter_max_us="));
+  Serial.print(frameJitterMax);
+  Serial.print(F(" jitter_avg_us="));
+  Serial.print(frameCount > 0 ? frameJitterTotal / frameCount : 0);
+  Serial.print(F(" skipped_writes="));
+  Serial.println(getSkippedServoWrites());
+
+  frameCount = 0;
+  frameOverruns = 0;
+  frameJitterTotal = 0;
+  frameJitterMin = 0xFFFFFFFF;
+  frameJitterMax = 0;
+}
@@ -0,0 +1,522 @@
+/**
+ * @file        hal_native.cpp
+ * @author      Simon Håkansson
+ * @date        2025-09-19
+ * @brief       Simulated Arduino backend for the native build.
+ *
+ * @details     Only compiled when ARDUINO is not defined. Echo edges are
+ * queued as timed events and delivered in order while simulated time
+ * advances, each one updating the port input register and firing the
+ * pin-change vector if the firmware enabled it, just like the ATmega328P.
+ * I2C transmissions take the time they would on the bus at the set clock.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+#ifndef ARDUINO
+
+//-------------[ LIBRARIES ]-------------
+#include <stdio.h>
+#include <deque>
+#include <vector>
+#include <hal.h>
+
+//-------------[ INITIALIZATION ]-------------
+// Delay between the end of a trigger pulse and the rising echo edge
+const unsigned long SIM_ECHO_DELAY_US = 450;
+
+// Echo pulse an HC-SR04 produces when nothing answers
+const unsigned long SIM_NO_ECHO_US = 38000;
+
+// Time the ATmega328P takes to erase and program one EEPROM byte
+const unsigned long SIM_EEPROM_WRITE_US = 3400;
+
+const float SIM_SPEED_OF_SOUND = 0.0343; // cm per microsecond
+const uint8_t SIM_NUM_PINS = 20;
+
+SimSerial Serial;
+SimWire Wire;
+SimEEPROM EEPROM;
+
+volatile uint8_t PCICR = 0;
+volatile uint8_t simPinChangeMasks[3] = {0, 0, 0};
+volatile uint8_t simPortInputs[3] = {0, 0, 0};
+
+// The firmware provides these through ISR(); weak so builds without them link
+extern "C" void simPinChangeVector0(void) __attribute__((weak));
+extern "C" void simPinChangeVector1(void) __attribute__((weak));
+extern "C" void simPinChangeVector2(void) __attribute__((weak));
+
+// A pin level change scheduled for a point in simulated time
+struct SimPinEvent {
+  uint64_t time;
+  uint8_t pin;
+  uint8_t level;
+};
+
+// An ultrasonic sensor wired to a trigger and an echo pin
+struct SimUltrasonic {
+  uint8_t triggerPin;
+  uint8_t echoPin;
+  float distanceCm; // 0 or less means no echo
+  uint64_t burstArrival; // When its last burst reaches the other sensors, 0 before the first
+};
+
+static uint64_t simNow = 0;
+static uint8_t pinLevels[SIM_NUM_PINS];
+static std::vector<SimPinEvent> pinEvents;
+static std::vector<SimUltrasonic> ultrasonics;
+static float crosstalkPathCm = 0;
+
+static std::deque<uint8_t> serialInput;
+static void (*serialSink)(uint8_t c) = nullptr;
+
+static unsigned long wireBytes = 0;
+static unsigned long wireTransactions = 0;
+static uint8_t wireNacks = 0; // Transmissions left to refuse
+static uint8_t pca9685Registers[SIM_PCA9685_BOARDS][256];
+static void (*servoListener)(uint8_t address, uint8_t channel, uint16_t ticks) = nullptr;
+
+static uint8_t eepromBytes[E2END + 1];
+static uint64_t eepromBusyUntil = 0;
+static unsigned long eepromWrites = 0;
+
+//-------------[ FUNCTION PROTOTYPES ]-------------
+static void setPinLevel(uint8_t pin, uint8_t level);
+static bool isUltrasonicEcho(uint8_t pin);
+static bool hasPendingRise(uint8_t pin, uint64_t before);
+
+//-------------[ CORE ]-------------
+void pinMode(uint8_t, uint8_t) {}
+
+void digitalWrite(uint8_t pin, uint8_t value) {
+  if (pin >= SIM_NUM_PINS) {
+    return;
+  }
+  bool falling = pinLevels[pin] == HIGH && value == LOW;
+  pinLevels[pin] = value;
+  if (!falling) {
+    return;
+  }
+
+  // The end of a trigger pulse makes the matching sensor answer
+  for (size_t i = 0; i < ultrasonics.size(); i++) {
+    SimUltrasonic &sensor = ultrasonics[i];
+    if (sensor.triggerPin != pin || pinLevels[sensor.echoPin] == HIGH) {
+      continue;
+    }
+    unsigned long echo = sensor.distanceCm > 0
+        ? (unsigned long)(sensor.distanceCm * 2 / SIM_SPEED_OF_SOUND)
+        : SIM_NO_ECHO_US;
+    uint64_t rise = simNow + SIM_ECHO_DELAY_US;
+    uint64_t fall = rise + echo;
+
+    // A burst another sensor sent earlier can still arrive while this one listens
+    for (size_t j = 0; crosstalkPathCm > 0 && j < ultrasonics.size(); j++) {
+      uint64_t arrival = ultrasonics[j].burstArrival;
+      if (j != i && arrival > rise && arrival < fall) {
+        fall = arrival;
+      }
+    }
+    pinEvents.push_back({rise, sensor.echoPin, HIGH});
+    pinEvents.push_back({fall, sensor.echoPin, LOW});
+
+    // Other sensors still listening hear the burst once it has crossed to them
+    if (crosstalkPathCm > 0) {
+      uint64_t arrival = rise + (unsigned long)(crosstalkPathCm / SIM_SPEED_OF_SOUND);
+      sensor.burstArrival = arrival;
+      for (size_t j = 0; j < pinEvents.size(); j++) {
+        SimPinEvent &event = pinEvents[j];
+        if (event.pin != sensor.echoPin && event.level == LOW && isUltrasonicEcho(event.pin)
+            && event.time > arrival && (pinLevels[event.pin] == HIGH || hasPendingRise(event.pin, arrival))) {
+          event.time = arrival;
+        }
+      }
+    }
+  }
+}
+
+int digitalRead(uint8_t pin) {
+  return pin < SIM_NUM_PINS ? pinLevels[pin] : LOW;
+}
+
+unsigned long millis() {
+  return (unsigned long)(simNow / 1000);
+}
+
+unsigned long micros() {
+  return (unsigned long)simNow;
+}
+
+void delay(unsigned long ms) {
+  simAdvanceMicros(ms * 1000);
+}
+
+void delayMicroseconds(unsigned int us) {
+  simAdvanceMicros(us);
+}
+
+//-------------[ SERIAL ]-------------
+void SimSerial::begin(unsigned long rate) {
+  baud = rate;
+}
+
+int SimSerial::available() {
+  return (int)serialInput.size();
+}
+
+int SimSerial::read() {
+  if (serialInput.empty()) {
+    return -1;
+  }
+  uint8_t c = serialInput.front();
+  serialInput.pop_front();
+  return c;
+}
+
+int SimSerial::peek() {
+  return serialInput.empty() ? -1 : serialInput.front();
+}
+
+size_t SimSerial::write(uint8_t c) {
+  if (serialSink) {
+    serialSink(c);
+  } else {
+    putchar(c);
+  }
+  return 1;
+}
+
+size_t SimSerial::write(const uint8_t *buffer, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    write(buffer[i]);
+  }
+  return size;
+}
+
+size_t SimSerial::print(const char *s) {
+  return write((const uint8_t *)s, strlen(s));
+}
+
+size_t SimSerial::print(long n, int base) {
+  char text[24];
+  snprintf(text, sizeof(text), base == HEX ? "%lX" : "%ld", n);
+  return print(text);
+}
+
+size_t SimSerial::print(unsigned long n, int base) {
+  char text[24];
+  snprintf(text, sizeof(text), base == HEX ? "%lX" : "%lu", n);
+  return print(text);
+}
+
+size_t SimSerial::print(double n, int digits) {
+  char text[32];
+  snprintf(text, sizeof(text), "%.*f", digits, n);
+  return print(text);
+}
+
+//-------------[ I2C ]-------------
+void SimWire::beginTransmission(uint8_t target) {
+  address = target;
+  length = 0;
+}
+
+size_t SimWire::write(uint8_t data) {
+  if (length >= BUFFER_LENGTH) {
+    return 0; // Same as the AVR Wire library: the byte is dropped
+  }
+  buffer[length++] = data;
+  return 1;
+}
+
+uint8_t SimWire::endTransmission(bool) {
+  // A refused address ends the transmission before any data is sent
+  bool nack = wireNacks > 0;
+  uint8_t sent = nack ? 0 : length;
+  wireBytes += 1 + sent; // Address byte plus data
+  wireTransactions++;
+
+  // The AVR Wire library blocks until the bus is done: 9 clocks per byte
+  // with the acknowledge, plus about 2 for the start and stop conditions
+  unsigned long clocks = 9UL * (1 + sent) + 2;
+  simAdvanceMicros((clocks * 1000000UL + clockHz / 2) / clockHz);
+  if (nack) {
+    wireNacks--;
+    return 2; // Same as the AVR Wire library: address not acknowledged
+  }
+
+  // Keep the registers of simulated PCA9685 boards, with auto-increment
+  uint8_t board = address - 0x40;
+  if (address < 0x40 || board >= SIM_PCA9685_BOARDS || length == 0) {
+    return 0;
+  }
+  uint8_t reg = buffer[0];
+  for (uint8_t i = 1; i < length; i++, reg++) {
+    pca9685Registers[board][reg] = buffer[i];
+    bool channelComplete = reg >= PCA9685_LED0_ON_L && reg < PCA9685_LED0_ON_L + 64
+                           && (reg - PCA9685_LED0_ON_L) % 4 == 3;
+    if (channelComplete && servoListener) {
+      uint8_t channel = (reg - PCA9685_LED0_ON_L) / 4;
+      servoListener(address, channel, simServoTicks(address, channel));
+    }
+  }
+  return 0;
+}
+
+//-------------[ PCA9685 DRIVER ]-------------
+uint8_t Adafruit_PWMServoDriver::setPWM(uint8_t channel, uint16_t on, uint16_t off) {
+  Wire.beginTransmission(address);
+  Wire.write(PCA9685_LED0_ON_L + 4 * channel);
+  Wire.write(on);
+  Wire.write(on >> 8);
+  Wire.write(off);
+  Wire.write(off >> 8);
+  return Wire.endTransmission();
+}
+
+//-------------[ EEPROM ]-------------
+SimEEPROM::SimEEPROM() {
+  simEraseEEPROM();
+}
+
+uint8_t SimEEPROM::read(int address) {
+  return eepromBytes[address & E2END];
+}
+
+void SimEEPROM::write(int address, uint8_t value) {
+  // eeprom_write_byte() waits for the previous write, then starts this one
+  if (!eeprom_is_ready()) {
+    simAdvanceMicros(eepromBusyUntil - simNow);
+  }
+  eepromBytes[address & E2END] = value;
+  eepromBusyUntil = simNow + SIM_EEPROM_WRITE_US;
+  eepromWrites++;
+}
+
+void SimEEPROM::update(int address, uint8_t value) {
+  if (read(address) != value) {
+    write(address, value);
+  }
+}
+
+bool eeprom_is_ready() {
+  return simNow >= eepromBusyUntil;
+}
+
+//-------------[ SIMULATION CONTROL ]-------------
+/**
+ * @brief  Returns the simulated hardware to its power-on state.
+ *
+ * @details The EEPROM contents are kept, see simEraseEEPROM().
+ */
+void simReset() {
+  simNow = 0;
+  memset(pinLevels, 0, sizeof(pinLevels));
+  pinEvents.clear();
+  ultrasonics.clear();
+  crosstalkPathCm = 0;
+  serialInput.clear();
+  serialSink = nullptr;
+  wireBytes = 0;
+  wireTransactions = 0;
+  wireNacks = 0;
+  memset(pca9685Registers, 0, sizeof(pca9685Registers));
+  servoListener = nullptr;
+  eepromBusyUntil = 0;
+  eepromWrites = 0;
+  PCICR = 0;
+  memset((void *)simPinChangeMasks, 0, sizeof(simPinChangeMasks));
+  memset((void *)simPortInputs, 0, sizeof(simPortInputs));
+}
+
+/**
+ * @brief  Moves simulated time forward, delivering due pin events in order.
+ *
+ * @param   us Microseconds to advance.
+ */
+void simAdvanceMicros(unsigned long us) {
+  uint64_t target = simNow + us;
+
+  while (true) {
+    size_t next = pinEvents.size();
+    for (size_t i = 0; i < pinEvents.size(); i++) {
+      if (pinEvents[i].time <= target && (next == pinEvents.size() || pinEvents[i].time < pinEvents[next].time)) {
+        next = i;
+      }
+    }
+    if (next == pinEvents.size()) {
+      break;
+    }
+    SimPinEvent event = pinEvents[next];
+    pinEvents.erase(pinEvents.begin() + next);
+    if (event.time > simNow) {
+      simNow = event.time;
+    }
+    setPinLevel(event.pin, event.level);
+  }
+
+  simNow = target;
+}
+
+/**
+ * @brief  Returns the simulated time in microseconds, without wrapping.
+ */
+uint64_t simMicros() {
+  return simNow;
+}
+
+/**
+ * @brief  Wires a simulated ultrasonic sensor to a trigger and echo pin.
+ */
+void simAttachUltrasonic(uint8_t triggerPin, uint8_t echoPin) {
+  ultrasonics.push_back({triggerPin, echoPin, 0, 0});
+}
+
+/**
+ * @brief  Sets the distance a sensor reports from its next ping on.
+ *
+ * @param   echoPin The echo pin of the sensor.
+ * @param   distanceCm Distance to the target, 0 or less for no echo.
+ */
+void simSetUltrasonicDistance(uint8_t echoPin, float distanceCm) {
+  for (size_t i = 0; i < ultrasonics.size(); i++) {
+    if (ultrasonics[i].echoPin == echoPin) {
+      ultrasonics[i].distanceCm = distanceCm;
+    }
+  }
+}
+
+/**
+ * @brief  Makes every sensor hear every other sensor's burst.
+ *
+ * @details A burst ends the echo of any sensor listening when it arrives,
+ * whether that sensor was triggered before or after it.
+ *
+ * @param   pathCm Distance the sound travels from one sensor to another, 0 for none.
+ */
+void simSetUltrasonicCrosstalk(float pathCm) {
+  crosstalkPathCm = pathCm;
+}
+
+/**
+ * @brief  Queues bytes as if the host had sent them.
+ */
+void simSerialInput(const char *data, size_t length) {
+  serialInput.insert(serialInput.end(), data, data + length);
+}
+
+/**
+ * @brief  Redirects serial output, nullptr for stdout.
+ */
+void simSetSerialOutput(void (*sink)(uint8_t c)) {
+  serialSink = sink;
+}
+
+/**
+ * @brief  Returns the bytes sent on the I2C bus, address bytes included.
+ */
+unsigned long simWireBytes() {
+  return wireBytes;
+}
+
+/**
+ * @brief  Returns the number of I2C transmissions.
+ */
+unsigned long simWireTransactions() {
+  return wireTransactions;
+}
+
+/**
+ * @brief  Makes the next I2C transmissions fail as if no board answered.
+ *
+ * @param   count The number of transmissions to refuse.
+ */
+void simNackWireTransmissions(uint8_t count) {
+  wireNacks = count;
+}
+
+/**
+ * @brief  Returns the off-tick last written to a PCA9685 channel.
+ */
+uint16_t simServoTicks(uint8_t address, uint8_t channel) {
+  const uint8_t *registers = pca9685Registers[address - 0x40];
+  uint8_t reg = PCA9685_LED0_ON_L + 4 * channel;
+  return registers[reg + 2] | ((registers[reg + 3] & 0x0F) << 8);
+}
+
+/**
+ * @brief  Registers a callback for every completed PCA9685 channel write.
+ */
+void simSetServoListener(void (*listener)(uint8_t address, uint8_t channel, uint16_t ticks)) {
+  servoListener = listener;
+}
+
+/**
+ * @brief  Sets every EEPROM byte to 0xFF, as on a new chip.
+ */
+void simEraseEEPROM() {
+  memset(eepromBytes, 0xFF, sizeof(eepromBytes));
+}
+
+/**
+ * @brief  Returns the number of EEPROM bytes programmed since simReset().
+ */
+unsigned long simEEPROMWrites() {
+  return eepromWrites;
+}
+
+//-------------[ HELPER FUNCTIONS ]-------------
+/**
+ * @brief  Returns true if a pin is the echo pin of a simulated sensor.
+ */
+static bool isUltrasonicEcho(uint8_t pin) {
+  for (size_t i = 0; i < ultrasonics.size(); i++) {
+    if (ultrasonics[i].echoPin == pin) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief  Returns true if a pin is scheduled to rise before a point in time.
+ */
+static bool hasPendingRise(uint8_t pin, uint64_t before) {
+  for (size_t i = 0; i < pinEvents.size(); i++) {
+    if (pinEvents[i].pin == pin && pinEvents[i].level == HIGH && pinEvents[i].time <= before) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * @brief  Changes an input pin and fires its pin-change vector if enabled.
+ */
+static void setPinLevel(uint8_t pin, uint8_t level) {
+  if (pin >= SIM_NUM_PINS || pinLevels[pin] == level) {
+    return;
+  }
+  pinLevels[pin] = level;
+
+  uint8_t group = simPinGroup(pin);
+  uint8_t mask = 1 << simPinBit(pin);
+  if (level) {
+    simPortInputs[group] |= mask;
+  } else {
+    simPortInputs[group] &= ~mask;
+  }
+
+  if (!(PCICR & (1 << group)) || !(simPinChangeMasks[group] & mask)) {
+    return;
+  }
+  void (*vector)(void) = group == 0 ? simPinChangeVector0 : (group == 1 ? simPinChangeVector1 : simPinChangeVector2);
+  if (vector) {
+    vector();
+  }
+}
+
+#endif // ARDUINO
@@ -0,0 +1,245 @@
+/**
+ * @file        host_protocol.cpp
+ * @author      Simon Håkansson
+ * @date        2025-09-15
+ * @brief       Text and binary messaging between the firmware and the host.
+ *
+ * @details     COBS replaces every 0x00 in the frame so that 0x00 can mark
+ * the end of a frame, at a cost of one byte per frame this size. The CRC8
+ * uses polynomial 0x07 with a zero start value and covers the opcode and
+ * payload. Frames that fail to decode or fail the CRC are dropped and
+ * reported as link errors.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+//-------------[ LIBRARIES ]-------------
+#include <hal.h>
+#include <host_protocol.h>
+#include <link_speed.h>
+#include <serial_commands.h>
+
+//-------------[ INITIALIZATION ]-------------
+// Opcode, payload and CRC of the largest frame
+const uint8_t HOST_FRAME_LENGTH = HOST_FRAME_PAYLOAD_LENGTH + 2;
+
+// COBS adds one byte per 254 bytes of data, so one byte for any frame here
+const uint8_t HOST_ENCODED_LENGTH = HOST_FRAME_LENGTH + 1;
+
+// Text names of the events, indexed by HostEvent
+static const char HOST_EVENT_NAMES[NUM_HOST_EVENTS][24] PROGMEM = {
+  "user_approach_start",
+  "user_approach_end",
+  "user_interaction_start",
+  "user_interaction_end",
+  "ready",
+};
+
+// Text replies to movement uploads, indexed by MovementResult
+static const char MOVEMENT_RESULT_NAMES[NUM_MOVEMENT_RESULTS][20] PROGMEM = {
+  "movement:rejected",
+  "movement:staged",
+  "movements:active",
+};
+
+// Current protocol and the telemetry streams the host asked for
+static bool binaryProtocol = false;
+static uint8_t telemetryMask = 0;
+
+// The frame being received, still COBS-encoded
+static uint8_t frameBuffer[HOST_ENCODED_LENGTH];
+static uint8_t frameLength = 0;
+static bool frameOverflow = false;
+
+//-------------[ FUNCTION PROTOTYPES ]-------------
+static uint8_t decodeCobs(uint8_t *buffer, uint8_t length);
+
+//-------------[ PUBLIC FUNCTIONS ]-------------
+/**
+ * @brief  Returns true while the link uses binary frames.
+ */
+bool isBinaryProtocol() {
+  return binaryProtocol;
+}
+
+/**
+ * @brief  Switches the link between text lines and binary frames.
+ *
+ * @param   enabled True for binary frames, false for text lines.
+ */
+void setBinaryProtocol(bool enabled) {
+  binaryProtocol = enabled;
+  frameLength = 0;
+  frameOverflow = false;
+  if (!enabled) {
+    telemetryMask = 0;
+  }
+}
+
+/**
+ * @brief  Returns the telemetry streams that are switched on.
+ */
+uint8_t getTelemetryMask() {
+  return telemetryMask;
+}
+
+/**
+ * @brief  Switches telemetry streams on or off.
+ *
+ * @param   mask A combination of the TELEMETRY_* bits.
+ */
+void setTelemetryMask(uint8_t mask) {
+  telemetryMask = mask;
+}
+
+/**
+ * @brief  Reports an event to the host in the current protocol.
+ *
+ * @param   event The event to report.
+ */
+void sendHostEvent(HostEvent event) {
+  if (binaryProtocol) {
+    uint8_t payload = event;
+    sendHostFrame(OPCODE_EVENT, &payload, 1);
+    return;
+  }
+
+  Serial.print(F("event:"));
+  Serial.println((const __FlashStringHelper *)HOST_EVENT_NAMES[event]);
+}
+
+/**
+ * @brief  Answers a movement set upload in the current protocol.
+ *
+ * @param   result The outcome of the upload.
+ */
+void sendMovementResult(MovementResult result) {
+  if (binaryProtocol) {
+    uint8_t payload = result;
+    sendHostFrame(OPCODE_MOVEMENT_RESULT, &payload, 1);
+    return;
+  }
+
+  Serial.println((const __FlashStringHelper *)MOVEMENT_RESULT_NAMES[result]);
+}
+
+/**
+ * @brief  Encodes and sends one binary frame.
+ *
+ * @details The frame is COBS-encoded on the fly, so it is never held in
+ * memory as a whole.
+ *
+ * @param   opcode The HostOpcode of the frame.
+ * @param   payload The payload bytes, may be nullptr when length is 0.
+ * @param   length The number of payload bytes, at most HOST_FRAME_PAYLOAD_LENGTH.
+ */
+void sendHostFrame(uint8_t opcode, const uint8_t *payload, uint8_t length) {
+  uint8_t frame[HOST_FRAME_LENGTH];
+  frame[0] = opcode;
+  if (length > 0) {
+    memcpy(frame + 1, payload, length);
+  }
+  frame[length + 1] = crc8(frame, length + 1);
+  uint8_t frameSize = length + 2;
+
+  // Each block is a code byte with the distance to the next zero, then the
+  // non-zero bytes up to it
+  uint8_t blockStart = 0;
+  for (uint8_t i = 0; i <= frameSize; i++) {
+    if (i == frameSize || frame[i] == 0) {
+      Serial.write((uint8_t)(i - blockStart + 1));
+      Serial.write(frame + blockStart, i - blockStart);
+      blockStart = i + 1;
+    }
+  }
+  Serial.write((uint8_t)0);
+}
+
+/**
+ * @brief  Consumes waiting serial bytes and returns a frame once complete.
+ *
+ * @details Reads at most SERIAL_BYTES_PER_POLL bytes and stops after the
+ * first completed frame, so the rest is handled on the next call.
+ *
+ * @param   length Set to the number of bytes in the returned frame.
+ *
+ * @return  The opcode followed by the payload, valid until the next call,
+ *          or nullptr if no valid frame has been completed.
+ */
+const uint8_t *readHostFrame(uint8_t &length) {
+  for (uint8_t i = 0; i < SERIAL_BYTES_PER_POLL && Serial.available() > 0; i++) {
+    uint8_t c = Serial.read();
+
+    if (c != 0) {
+      if (frameLength < HOST_ENCODED_LENGTH) {
+        frameBuffer[frameLength++] = c;
+      } else {
+        frameOverflow = true;
+      }
+      continue;
+    }
+
+    // End of frame: decode it and check the CRC over opcode and payload
+    uint8_t decoded = frameOverflow ? 0 : decodeCobs(frameBuffer, frameLength);
+    frameLength = 0;
+    frameOverflow = false;
+    if (decoded >= 2 && crc8(frameBuffer, decoded - 1) == frameBuffer[decoded - 1]) {
+      length = decoded - 1;
+      return frameBuffer;
+    }
+    reportLinkError();
+  }
+
+  return nullptr;
+}
+
+/**
+ * @brief  Computes the CRC8 (polynomial 0x07) of a block of bytes.
+ *
+ * @param   data The bytes to check.
+ * @param   length The number of bytes.
+ *
+ * @return  The CRC8 of the bytes.
+ */
+uint8_t crc8(const uint8_t *data, uint8_t length) {
+  uint8_t crc = 0;
+  for (uint8_t i = 0; i < length; i++) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+    }
+  }
+  return crc;
+}
+
+//-------------[ HELPER FUNCTIONS ]-------------
+/**
+ * @brief  Decodes a COBS block sequence in place.
+ *
+ * @param   buffer The encoded bytes, without the 0x00 delimiter.
+ * @param   length The number of encoded bytes.
+ *
+ * @return  The number of decoded bytes, or 0 if the encoding is invalid.
+ */
+static uint8_t decodeCobs(uint8_t *buffer, uint8_t length) {
+  uint8_t read = 0;
+  uint8_t write = 0;
+
+  while (read < length) {
+    uint8_t code = buffer[read++];
+    if (code == 0 || read + code - 1 > length) {
+      return 0;
+    }
+    for (uint8_t i = 1; i < code; i++) {
+      buffer[write++] = buffer[read++];
+    }
+    // Every block but the last stands for a zero byte in the data
+    if (code < 0xFF && read < length) {
+      buffer[write++] = 0;
+    }
+  }
+
+  return write;
+}
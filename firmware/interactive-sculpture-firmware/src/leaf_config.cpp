@@ -0,0 +1,19 @@
+/**
+ * @file        leaf_config.cpp
+ * @author      Simon Håkansson
+ * @date        2025-09-26
+ * @brief       Flash copy of the per-leaf configuration.
+ *
+ * @details     The table is built entirely by the compiler from config.h, so
+ * it is emitted straight into PROGMEM with no start-up code.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+//-------------[ LIBRARIES ]-------------
+#include <leaf_config.h>
+
+//-------------[ LEAF TABLE ]-------------
+const LeafConfigTable LEAF_CONFIG PROGMEM = buildLeafConfig(MakeIndexSequence<NUM_LEAVES>::type());
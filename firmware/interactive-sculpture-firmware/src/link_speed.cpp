@@ -0,0 +1,163 @@
+/**
+ * @file        link_speed.cpp
+ * @author      Simon Håkansson
+ * @date        2025-09-17
+ * @brief       Baud rate negotiation and fallback for the host link.
+ *
+ * @details     Link errors are unknown commands, overlong lines and binary
+ * frames that fail their CRC, which is what a marginal rate produces. They
+ * are counted over LINK_ERROR_WINDOW_MS windows. The fallback always goes
+ * to BAUD_RATE because that is the only rate both sides are sure to share.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+//-------------[ LIBRARIES ]-------------
+#include <hal.h>
+#include <config.h>
+#include <host_protocol.h>
+#include <link_speed.h>
+
+//-------------[ INITIALIZATION ]-------------
+const uint8_t NUM_NEGOTIATED_BAUD_RATES = sizeof(NEGOTIATED_BAUD_RATES) / sizeof(NEGOTIATED_BAUD_RATES[0]);
+
+/**
+ * @brief  Checks that the UART hits every offered rate without divisor error.
+ *
+ * @details HardwareSerial runs the UART in double-speed mode, where the
+ * rate is F_CPU / (8 * (UBRR + 1)).
+ */
+constexpr bool hasExactDivisors(uint8_t index) {
+  return index >= NUM_NEGOTIATED_BAUD_RATES
+      || (F_CPU % (8UL * NEGOTIATED_BAUD_RATES[index]) == 0 && hasExactDivisors(index + 1));
+}
+static_assert(hasExactDivisors(0), "Every negotiated baud rate must divide the CPU clock exactly");
+
+// Rate the link currently runs at
+static unsigned long linkBaudRate = BAUD_RATE;
+
+// Set while a new rate waits for the host's confirmation
+static bool awaitingConfirmation = false;
+static unsigned long confirmationDeadline = 0;
+
+// Errors seen in the current window
+static uint8_t linkErrors = 0;
+static unsigned long linkErrorWindow = 0;
+
+//-------------[ FUNCTION PROTOTYPES ]-------------
+static void setLinkBaudRate(unsigned long rate);
+static bool isNegotiatedBaudRate(unsigned long rate);
+
+//-------------[ PUBLIC FUNCTIONS ]-------------
+/**
+ * @brief  Reverts an unconfirmed or failing rate. Call this every loop() pass.
+ */
+void updateLinkSpeed() {
+  if (awaitingConfirmation && (long)(millis() - confirmationDeadline) >= 0) {
+    awaitingConfirmation = false;
+    setLinkBaudRate(BAUD_RATE);
+  }
+
+  if (millis() - linkErrorWindow >= LINK_ERROR_WINDOW_MS) {
+    linkErrorWindow = millis();
+    linkErrors = 0;
+  }
+}
+
+/**
+ * @brief  Handles the "baud:" commands from the host.
+ *
+ * @param   value Unused.
+ * @param   arguments A proposed rate, "confirm", or "reset" to return to
+ *                    BAUD_RATE when the host has seen too many errors.
+ */
+void handleBaudCommand(int value, const char *arguments) {
+  if (strcmp_P(arguments, PSTR("reset")) == 0) {
+    awaitingConfirmation = false;
+    setLinkBaudRate(BAUD_RATE);
+    return;
+  }
+
+  if (strcmp_P(arguments, PSTR("confirm")) == 0) {
+    if (awaitingConfirmation) {
+      awaitingConfirmation = false;
+      Serial.println(F("baud:ok"));
+    }
+    return;
+  }
+
+  unsigned long rate = strtoul(arguments, nullptr, 10);
+  if (!isNegotiatedBaudRate(rate)) {
+    Serial.println(F("baud:nak"));
+    return;
+  }
+
+  Serial.print(F("baud:ack:"));
+  Serial.println(rate);
+  setLinkBaudRate(rate);
+  awaitingConfirmation = true;
+  confirmationDeadline = millis() + BAUD_CONFIRM_TIMEOUT_MS;
+}
+
+/**
+ * @brief  Counts a garbled message and falls back when there are too many.
+ */
+void reportLinkError() {
+  if (linkBaudRate == BAUD_RATE || awaitingConfirmation) {
+    return;
+  }
+
+  if (++linkErrors >= LINK_ERROR_LIMIT) {
+    linkErrors = 0;
+    // Announce the fallback at the old rate so the host can follow
+    if (isBinaryProtocol()) {
+      sendHostFrame(OPCODE_LINK_FALLBACK, nullptr, 0);
+    } else {
+      Serial.println(F("baud:fallback"));
+    }
+    setLinkBaudRate(BAUD_RATE);
+  }
+}
+
+/**
+ * @brief  Returns the rate the link currently runs at.
+ */
+unsigned long getLinkBaudRate() {
+  return linkBaudRate;
+}
+
+//-------------[ HELPER FUNCTIONS ]-------------
+/**
+ * @brief  Switches the UART to a new rate once pending output has been sent.
+ *
+ * @details Negotiation happens in text, so going back to BAUD_RATE also
+ * leaves the binary protocol.
+ *
+ * @param   rate The new baud rate.
+ */
+static void setLinkBaudRate(unsigned long rate) {
+  Serial.flush();
+  Serial.begin(rate);
+  linkBaudRate = rate;
+  if (rate == BAUD_RATE) {
+    setBinaryProtocol(false);
+  }
+}
+
+/**
+ * @brief  Checks a proposed rate against NEGOTIATED_BAUD_RATES.
+ *
+ * @param   rate The proposed baud rate.
+ *
+ * @return  True if the rate may be used.
+ */
+static bool isNegotiatedBaudRate(unsigned long rate) {
+  for (uint8_t i = 0; i < NUM_NEGOTIATED_BAUD_RATES; i++) {
+    if (NEGOTIATED_BAUD_RATES[i] == rate) {
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,92 @@
+/**
+ * @file        loop_profiler.cpp
+ * @author      Simon Håkansson
+ * @date        2025-09-24
+ * @brief       Per-subsystem loop timing with log2 histograms.
+ *
+ * @details     Each section costs 16 saturating 16-bit counters plus its
+ * sample count and worst case, about 200 bytes of SRAM in total. Recording
+ * a sample is a handful of shifts, so the profiler hardly disturbs what it
+ * measures.
+ *
+ *              Output, one line per section:
+ *              stats:loop count=... max_us=... hist=b0,b1,...,b15
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+#ifdef LOOP_PROFILING
+
+//-------------[ LIBRARIES ]-------------
+#include <hal.h>
+#include <loop_profiler.h>
+
+//-------------[ INITIALIZATION ]-------------
+// Timing statistics of one section since the last report
+struct ProfileStats {
+  unsigned long count;
+  unsigned long maxDuration;
+  uint16_t histogram[PROFILE_HISTOGRAM_BUCKETS];
+};
+
+static ProfileStats profileStats[NUM_PROFILE_SECTIONS];
+
+// Report names, indexed by ProfileSection
+static const char PROFILE_SECTION_NAMES[NUM_PROFILE_SECTIONS][8] PROGMEM = {
+  "loop", "leaves", "sensors", "serial", "link", "store"
+};
+
+//-------------[ PUBLIC FUNCTIONS ]-------------
+/**
+ * @brief  Counts one timed run of a section.
+ *
+ * @param   section The section that was timed.
+ * @param   duration How long it took in microseconds.
+ */
+void recordProfileSample(ProfileSection section, unsigned long duration) {
+  ProfileStats &stats = profileStats[section];
+
+  // The bucket is the bit length of the duration
+  uint8_t bucket = 0;
+  for (unsigned long rest = duration; rest && bucket < PROFILE_HISTOGRAM_BUCKETS - 1; rest >>= 1) {
+    bucket++;
+  }
+
+  if (stats.histogram[bucket] < UINT16_MAX) {
+    stats.histogram[bucket]++;
+  }
+  stats.count++;
+  if (duration > stats.maxDuration) {
+    stats.maxDuration = duration;
+  }
+}
+
+/**
+ * @brief  Prints the histogram of every section and clears them.
+ */
+void printProfileStats() {
+  for (uint8_t i = 0; i < NUM_PROFILE_SECTIONS; i++) {
+    ProfileStats &stats = profileStats[i];
+
+    Serial.print(F("stats:"));
+    Serial.print(reinterpret_cast<const __FlashStringHelper *>(PROFILE_SECTION_NAMES[i]));
+    Serial.print(F(" count="));
+    Serial.print(stats.count);
+    Serial.print(F(" max_us="));
+    Serial.print(stats.maxDuration);
+    Serial.print(F(" hist="));
+    for (uint8_t bucket = 0; bucket < PROFILE_HISTOGRAM_BUCKETS; bucket++) {
+      if (bucket > 0) {
+        Serial.print(',');
+      }
+      Serial.print(stats.histogram[bucket]);
+    }
+    Serial.println();
+  }
+
+  memset(profileStats, 0, sizeof(profileStats));
+}
+
+#endif // LOOP_PROFILING
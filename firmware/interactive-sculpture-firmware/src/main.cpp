@@ -16,36 +16,102 @@
  * See the LICENSE file in the project root for the full license text.
  */
 //-------------[ LIBRARIES ]-------------
-#include <Arduino.h>
-#include <Adafruit_PWMServoDriver.h>
-#include <Wire.h>
+#include <hal.h>
+#include <benchmark.h>
 #include <config.h>
+#include <distance_filter.h>
+#include <frame_scheduler.h>
+#include <host_protocol.h>
+#include <leaf_config.h>
+#include <link_speed.h>
+#include <loop_profiler.h>
+#include <motion_kernel.h>
+#include <movement_store.h>
+#include <movement_transition.h>
+#include <serial_commands.h>
+#include <servo_output.h>
+#include <ultrasonic.h>
 
 //-------------[ INITIALIZATION ]-------------
-// Create an instance of the Adafruit_PWMServoDriver class
-Adafruit_PWMServoDriver pwm = Adafruit_PWMServoDriver();
-
+// Hot per-leaf state, one array per field. Everything constant about a
+// leaf is read from LEAF_CONFIG in flash.
 // Initialize an array to hold the current phase for each leaf
-float currentPhases[NUM_LEAVES];
+uint32_t currentPhases[NUM_LEAVES];
+
+// Phase advance per motion timestep for each leaf in the current state
+uint32_t phaseSteps[NUM_LEAVES];
+
+// Pulse midpoint and half-span of the active movement, shared by all leaves
+ServoCalibration movementCalibration;
 
 // Set up state machone for movement
 MovementState movementState = IDLE; // Start in IDLE state
 
 // Set up state machine for user detection
 UserState userState = NO_USER;
+unsigned long userStateTime = 0; // When userState last changed
 
-// Concurrency variables for each separate task
-unsigned long userDetectTime = 0;
+// Motion integrator clock and the time not yet consumed by a whole timestep
+unsigned long motionTime = 0;
+unsigned long motionAccumulator = 0;
+
+// Startup ramp progress: the next leaf to switch on and when the last one was
+int startupLeaf = 0;
+unsigned long startupStepTime = 0;
+bool leavesReady = false;
+
+// User detection thresholds in the distance filter's millimeters
+const uint16_t APPROACH_ENTER_MM = APPROACH_ENTER_CM * 10;
+const uint16_t APPROACH_EXIT_MM = APPROACH_EXIT_CM * 10;
+const uint16_t INTERACTION_ENTER_MM = INTERACTION_ENTER_CM * 10;
+const uint16_t INTERACTION_EXIT_MM = INTERACTION_EXIT_CM * 10;
 
 //-------------[ FUNCTION PROTOTYPES ]-------------
-void moveLeaf(float phase, int leafIndex);
-void initializeLeafPositions();
+void moveLeaf(uint32_t phase, int leafIndex);
+bool updateStartupRamp();
 void updateLeafMovement();
 void setMovementState(MovementState state);
+void applyActiveMovement();
 float mapFloat(float x, float in_min, float in_max, float out_min, float out_max);
-float readUltrasonicDistance(SensorType sensor);
 void userDetection();
+void setUserState(UserState state, HostEvent event);
+unsigned long getUserStateDwell(UserState state);
 void readSerialCommands();
+void handleSetStateCommand(int state, const char *arguments);
+void handleFrameStatsCommand(int value, const char *arguments);
+void handleProtocolCommand(int value, const char *arguments);
+void handleUploadMovementCommand(int value, const char *arguments);
+void handleActivateMovementsCommand(int value, const char *arguments);
+void handleDefaultMovementsCommand(int value, const char *arguments);
+void activateUploadedMovements();
+#ifdef LOOP_PROFILING
+void handleStatsCommand(int value, const char *arguments);
+#endif
+void handleHostFrame(const uint8_t *frame, uint8_t length);
+void sendDistanceTelemetry(uint16_t approachMm, uint16_t interactionMm);
+void sendLeafTelemetry(int leafIndex, uint32_t phase, uint16_t pulseTicks);
+#ifdef BENCHMARK
+void runFirmwareBenchmarks();
+#endif
+
+//-------------[ SERIAL COMMANDS ]-------------
+// Commands accepted from the host computer, one per line
+const SerialCommand SERIAL_COMMANDS[] PROGMEM = {
+    {"set_state:REACTING_POSITIVE", handleSetStateCommand, REACTING_POSITIVE},
+    {"set_state:REACTING_NEGATIVE", handleSetStateCommand, REACTING_NEGATIVE},
+    {"set_state:REACTING_NEUTRAL", handleSetStateCommand, REACTING_NEUTRAL},
+    {"set_state:IDLE", handleSetStateCommand, IDLE},
+    {"stats:frames", handleFrameStatsCommand, 0},
+#ifdef LOOP_PROFILING
+    {"stats", handleStatsCommand, 0},
+#endif
+    {"protocol:binary", handleProtocolCommand, 0},
+    {"movement:", handleUploadMovementCommand, 0},
+    {"movements:activate", handleActivateMovementsCommand, 0},
+    {"movements:defaults", handleDefaultMovementsCommand, 0},
+    {"baud:", handleBaudCommand, 0},
+};
+const uint8_t NUM_SERIAL_COMMANDS = sizeof(SERIAL_COMMANDS) / sizeof(SERIAL_COMMANDS[0]);
 
 //-------------[ SETUP FUNCTION ]-------------
 void setup() {
@@ -53,39 +119,52 @@ void setup() {
   // Initialize serial communication for debugging
   Serial.begin(BAUD_RATE);
 
-  // Set the pin modes for the ultrasonic sensors
-  pinMode(APPROACH_TRIG_PIN, OUTPUT);
-  pinMode(APPROACH_ECHO_PIN, INPUT);
-  pinMode(INTERACTION_TRIG_PIN, OUTPUT);
-  pinMode(INTERACTION_ECHO_PIN, INPUT);
+  // Set up the ultrasonic sensor pins and echo interrupts
+  initializeUltrasonicSensors();
     
   // Initialize the PCA9685 servo driver.
-  pwm.begin();
-  pwm.setPWMFreq(SERVO_FREQUENCY);
+  initializeServoOutput();
 
   // Initialize the starting phase for each leaf
   for (int i = 0; i < NUM_LEAVES; i++) {
-    currentPhases[i] = LEAF_BASELINES[i].phaseOffset;
+    currentPhases[i] = getLeafInitialPhase(i);
   }
 
-  // Move leaves to starting position
-  initializeLeafPositions();
-  
+  // Load the movement sets the host last uploaded, if any
+  loadMovementSets();
+
+  // Start in the initial state without a transition. The leaves are
+  // brought to their starting positions by the startup ramp in loop().
+  setActiveMovement(getMovementSet(movementState));
+  applyActiveMovement();
+
+#ifdef BENCHMARK
+  // Time the firmware under simavr instead of running the installation
+  runFirmwareBenchmarks();
+#endif
 
 }
 
 //-------------[ MAIN LOOP ]-------------
 void loop() {
+  PROFILE(PROFILE_LOOP, {
 
     // Continuously update leaf movements
-    updateLeafMovement();
+    PROFILE(PROFILE_LEAVES, updateLeafMovement());
 
     // Check for user approach and interaction
-    userDetection(); 
+    PROFILE(PROFILE_SENSORS, userDetection());
 
     // Listen for commands from the host computer
-    readSerialCommands();
+    PROFILE(PROFILE_SERIAL, readSerialCommands());
+
+    // Revert unconfirmed or failing link speeds
+    PROFILE(PROFILE_LINK, updateLinkSpeed());
 
+    // Save activated movement sets to EEPROM in the background
+    PROFILE(PROFILE_STORE, updateMovementStore());
+
+  });
 }
 
   
@@ -95,104 +174,158 @@ void loop() {
  *
  * @details This is a core utility function that takes a point in an animation cycle
  * (the phase) and maps it to a precise pulse width for a specific servo,
- * respecting the pre-defined safe movement range for that leaf.
+ * respecting the pre-defined safe movement range for that leaf. The whole
+ * pipeline is integer-only: a Q15 waveform table, then one multiply-add with the
+ * active movement's precomputed center and amplitude, the leaf's trim, and a
+ * clamp to the leaf's range to get PCA9685 ticks.
  *
- * @param   phase The current phase of the sine wave for the leaf.
+ * @param   phase The current phase of the waveform for the leaf (2^32 per cycle).
  * @param   leafIndex The index of the leaf to move.
  * 
  */
-void moveLeaf(float phase, int leafIndex) {
+void moveLeaf(uint32_t phase, int leafIndex) {
   
-  // Calculate the sine value for the current phase of this leaf
-  float sinValue = sin(phase);
-
-  // Get the angle the leaf should have using float precision
-  float angle = mapFloat(sinValue, -1, 1, LEAF_RANGES[leafIndex].minAngle, LEAF_RANGES[leafIndex].maxAngle);
+  // Evaluate the active waveform at the current phase of this leaf
+  int16_t sinValue = sampleActiveWaveform(phase);
 
-  // Convert the angle to pulse width
-  int pulseWidth = mapFloat(angle, 0, SERVO_MAX_ANGLE, PULSEWIDTH_MIN, PULSEWIDTH_MAX);
+  // Map it straight to the servo pulse in PCA9685 ticks, within the slew limit
+  uint16_t pulseTicks = limitServoSlew(leafIndex, waveformToTicks(sinValue, movementCalibration, leafIndex));
   
-  // Set the servo position
-  pwm.writeMicroseconds(LEAF_PINS[leafIndex].servoPin, pulseWidth);
+  // Stage the servo position for the next frame
+  setServoTicks(leafIndex, pulseTicks);
+
+  if (getTelemetryMask() & TELEMETRY_LEAVES) {
+    sendLeafTelemetry(leafIndex, phase, pulseTicks);
+  }
 
 }
 
 /**
- * @brief  Initializes the leaf positions based on their starting phases.
- * 
+ * @brief  Brings the leaves to their starting positions without blocking.
+ *
+ * @details A servo's position is unknown until its first pulse, so each leaf
+ * is switched on at its starting position, one every
+ * STARTUP_LEAF_INTERVAL_MS, and only one servo makes the big first move at a
+ * time. Leaves not yet switched on get no pulse at all. STARTUP_SETTLE_MS
+ * after the last one, the motion clock starts and the host is sent the
+ * ready event. Sensors and serial keep running throughout.
+ *
+ * @return  True once the leaves are in place and animation has started.
  */
-void initializeLeafPositions() {
-  
-  for (int i = 0; i < NUM_LEAVES; i++) {
+bool updateStartupRamp() {
+  unsigned long now = millis();
 
-    // Move the leaf to its initial position based on its baseline phase offset
-    moveLeaf(LEAF_BASELINES[i].phaseOffset, i);
+  if (startupLeaf < NUM_LEAVES) {
+    if (startupLeaf > 0 && now - startupStepTime < STARTUP_LEAF_INTERVAL_MS) {
+      return false;
     }
 
-  // Give the servos a moment to reach their starting positions
-  delay(1500);  
+    // Move the leaf to its initial position based on its baseline phase offset
+    moveLeaf(currentPhases[startupLeaf], startupLeaf);
+    flushServoFrame();
+    startupLeaf++;
+    startupStepTime = now;
+    return false;
+  }
+
+  if (now - startupStepTime < STARTUP_SETTLE_MS) {
+    return false;
+  }
+
+  // Start the motion clock and frame schedule once the leaves are in place
+  motionTime = micros();
+  initializeFrameScheduler();
+  sendHostEvent(EVENT_READY);
+  return true;
 }
 
 /**
  * @brief  Moves the leaf servos in organic paths
  *
  * @details This function uses the moveLeaf() function to move all leaves in
- * organic undulating paths and handles phase wrapping to prevent overflow.
- *
- * @todo    Add logic to handle amplitude and centerAngle
+ * organic undulating paths. Phases are binary angles, so they wrap on
+ * overflow without any checks. Phases advance from elapsed micros() in fixed
+ * MOTION_TIMESTEP_US steps, so the animation speed does not depend on how
+ * fast loop() runs. A frame is only computed and sent when the frame
+ * scheduler says one is due, once per servo period. Until the startup ramp
+ * has finished, only the ramp is advanced.
  * 
  */
 void updateLeafMovement() {
 
-  MovementSet activeMovement;
-
-  // Select the correct movement parameters based on the current state
-  switch (movementState) {
-      case LISTEN:
-          activeMovement = LISTEN_MOVEMENT;
-          break;
-      case REACTING_POSITIVE:
-          activeMovement = POSITIVE_MOVEMENT;
-          break;
-      case REACTING_NEGATIVE:
-          activeMovement = NEGATIVE_MOVEMENT;
-          break;
-      case REACTING_NEUTRAL:
-          activeMovement = NEUTRAL_MOVEMENT;
-          break;            
-      case IDLE:
-      default:
-          activeMovement = IDLE_MOVEMENT;
-          break;
+  // Hold the animation until every leaf has been brought up
+  if (!leavesReady) {
+    leavesReady = updateStartupRamp();
+    return;
+  }
+
+  // Leave the CPU to sensors and serial until the next frame is due
+  if (!isMotionFrameDue()) {
+    return;
+  }
+
+  // Blend towards the target movement set while a transition runs
+  if (updateMovementTransition()) {
+    applyActiveMovement();
   }
-   
+
+  // Consume the elapsed time in whole timesteps and keep the remainder
+  unsigned long now = micros();
+  motionAccumulator += now - motionTime;
+  motionTime = now;
+  unsigned long steps = motionAccumulator / MOTION_TIMESTEP_US;
+  motionAccumulator -= steps * MOTION_TIMESTEP_US;
+
   for (int i = 0; i < NUM_LEAVES; i++) {
 
+    // Advance the phase by the elapsed timesteps for the current leaf
+    currentPhases[i] += phaseSteps[i] * steps;
+
     // Move the leaf to its new position based on the current phase
     moveLeaf(currentPhases[i], i);
 
-    // Increment the phase for the current leaf
-    currentPhases[i] += (LEAF_BASELINES[i].speed*activeMovement.speedFactor);
-
-    // Reset the phase of the leaf if it exceeds 2 * PI to avoid overflow
-    if (currentPhases[i] >= 2 * PI) {
-      currentPhases[i] -= 2 * PI;
-    }
-
   }  
+
+  // Send the frame to the servo driver
+  flushServoFrame();
 }
 
 /**
  * @brief  Changes the current state.
  * 
- * @param   state The new state to set.
+ * @details The movement parameters of the new state are blended in by the
+ * transition engine rather than switched at once.
  * 
- * @todo    Implement logic to handle smooth transitions between states
+ * @param   state The new state to set.
  * 
  */
 void setMovementState(MovementState state) {
   // Set the current state to the new state
   movementState = state;  
+
+  // Binary hosts are told about every state change
+  if (isBinaryProtocol()) {
+    uint8_t payload = state;
+    sendHostFrame(OPCODE_MOVEMENT_STATE, &payload, 1);
+  }
+
+  startMovementTransition(getMovementSet(state));
+}
+
+/**
+ * @brief  Precomputes the animation coefficients of the active movement.
+ * 
+ * @details Called whenever the active movement changes, so the animation
+ * loop never touches the float movement parameters otherwise.
+ */
+void applyActiveMovement() {
+  const MovementSet &movement = getActiveMovement();
+
+  movementCalibration = calibrateMovement(movement.centerAngle, movement.amplitude);
+
+  for (int i = 0; i < NUM_LEAVES; i++) {
+    phaseSteps[i] = getLeafPhaseStep(i) * movement.speedFactor;
+  }
 }
 
  /**
@@ -210,111 +343,361 @@ float mapFloat(float x, float in_min, float in_max, float out_min, float out_max
   return (x - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
 }
 
-/** 
- * @brief  Reads distance from the ultrasonic sensor.
- * 
- * @details This function triggers the selected ultrasonic sensor and reads 
- * the echo time to calculate the distance to the nearest object in centimeters.
- * 
- * @param   sensor The sensor type to read from.
- * 
- * @return  Distance in centimeters as a float. 
- * 
- * @todo change pulseIn() for a non-blocking read function like those found in NewPing
- */
-float readUltrasonicDistance(SensorType sensor) {
-  int triggerPin;
-  int echoPin;
-
-  // Select the correct pins based on the sensor type
-  switch (sensor) {
-    case APPROACH_SENSOR:
-      triggerPin = APPROACH_TRIG_PIN;
-      echoPin = APPROACH_ECHO_PIN;
-      break; // The 'break' is important!
-
-    case INTERACTION_SENSOR:
-      triggerPin = INTERACTION_TRIG_PIN;
-      echoPin = INTERACTION_ECHO_PIN;
-      break;
-  }
-  // Clear the trigger pin
-  digitalWrite(triggerPin, LOW);
-  delayMicroseconds(ULTRASONIC_CLEAR_PULSE);
-
-  // Set the trigger pin high for a specified pulse duration
-  digitalWrite(triggerPin, HIGH);
-  delayMicroseconds(ULTRASONIC_TRIGGER_PULSE);
-  digitalWrite(triggerPin, LOW);
-
-  // Read the echo pin and calculate the distance
-  long duration = pulseIn(echoPin, HIGH);
-  float distance = (duration * SPEED_OF_SOUND) / 2; // Convert to cm
-
-  return distance;
-}
-
 /** 
  * @brief  Determines if user is approaching or within interaction range.
  * 
- * @details This function uses the readUltrasonicDistance() to determine if the 
- * user is approaching and then if they lean within interaction range.
+ * @details This function uses the distances published by the non-blocking
+ * ranging engine, after the distance filter, to determine if the user is approaching and then if they
+ * lean within interaction range. Each state is entered at its ENTER distance
+ * and left beyond its EXIT distance, and only after its dwell time has passed.
  * It updates the userState accordingly and triggers state changesin the 
  * movement state machine and sends serial events that are used by the host 
  * computer to initiate AI interaction
  * . 
  */
 void userDetection() {
-    if (millis() - userDetectTime < SAMPLING_INTERVAL_MS) {
-        return; // Not time to sample yet
+    // Only evaluate once a fresh set of distances has been published
+    if (!updateUltrasonicRanging()) {
+        return;
     }
-    userDetectTime = millis(); // Update the timer
 
-    // Read the sensors once at the beginning of the check
-    float approachDistance = readUltrasonicDistance(APPROACH_SENSOR);
-    float interactionDistance = readUltrasonicDistance(INTERACTION_SENSOR);
+    uint16_t approachReading = distanceToMillimeters(getUltrasonicDistance(APPROACH_SENSOR));
+    uint16_t interactionReading = distanceToMillimeters(getUltrasonicDistance(INTERACTION_SENSOR));
+
+    if (getTelemetryMask() & TELEMETRY_DISTANCES) {
+        sendDistanceTelemetry(approachReading, interactionReading);
+    }
+
+    // Filter out stray echoes before comparing against the thresholds
+    uint16_t approachDistance = filterDistance(APPROACH_SENSOR, approachReading);
+    uint16_t interactionDistance = filterDistance(INTERACTION_SENSOR, interactionReading);
+
+    // Hold each state for its dwell time so brief changes raise no events
+    if (millis() - userStateTime < getUserStateDwell(userState)) {
+        return;
+    }
 
     // User detection state machine
     switch (userState) {
         case NO_USER:
-            if (approachDistance <= APPROACH_THRESHOLD_CM) {
-                Serial.println("event:user_approach_start");
-                userState = USER_APPROACHING;
+            if (approachDistance <= APPROACH_ENTER_MM) {
+                setUserState(USER_APPROACHING, EVENT_USER_APPROACH_START);
                 setMovementState(LISTEN);
             }
             break;
 
         case USER_APPROACHING:
-            if (interactionDistance <= INTERACTION_THRESHOLD_CM) {
-                Serial.println("event:user_interaction_start");
-                userState = USER_INTERACTING;
-            } else if (approachDistance > APPROACH_THRESHOLD_CM) {
-                Serial.println("event:user_approach_end");
-                userState = NO_USER;
+            if (interactionDistance <= INTERACTION_ENTER_MM) {
+                setUserState(USER_INTERACTING, EVENT_USER_INTERACTION_START);
+            } else if (approachDistance > APPROACH_EXIT_MM) {
+                setUserState(NO_USER, EVENT_USER_APPROACH_END);
                 setMovementState(IDLE);
             }
             break;
 
         case USER_INTERACTING:
-            if (interactionDistance > INTERACTION_THRESHOLD_CM) {
-                Serial.println("event:user_interaction_end");
-                userState = USER_APPROACHING;
+            if (interactionDistance > INTERACTION_EXIT_MM) {
+                setUserState(USER_APPROACHING, EVENT_USER_INTERACTION_END);
             }
             break;
     }
 }
+
+/**
+ * @brief  Changes the user state and tells the host.
+ *
+ * @param   state The new user state.
+ * @param   event The event announcing the change.
+ */
+void setUserState(UserState state, HostEvent event) {
+    sendHostEvent(event);
+    userState = state;
+    userStateTime = millis();
+}
+
+/**
+ * @brief  Returns how long a user state is held before it may change.
+ *
+ * @param   state The user state.
+ *
+ * @return  The state's minimum dwell time in milliseconds.
+ */
+unsigned long getUserStateDwell(UserState state) {
+    switch (state) {
+        case USER_APPROACHING:
+            return USER_APPROACHING_DWELL_MS;
+        case USER_INTERACTING:
+            return USER_INTERACTING_DWELL_MS;
+        default:
+            return NO_USER_DWELL_MS;
+    }
+}
+
+/**
+ * @brief  Handles commands from the host computer without blocking.
+ *
+ * @details Incoming bytes are parsed as they arrive. Once a full line has
+ * been received it is dispatched through the SERIAL_COMMANDS table. In binary
+ * mode complete frames are handled by handleHostFrame() instead.
+ */
 void readSerialCommands() {
-    if (Serial.available() > 0) {
-        String command = Serial.readStringUntil('\n');
-        
-        if (command == "set_state:REACTING_POSITIVE") {
-            setMovementState(REACTING_POSITIVE); 
-        } else if (command == "set_state:REACTING_NEGATIVE") {
-            setMovementState(REACTING_NEGATIVE); 
-        } else if (command == "set_state:REACTING_NEUTRAL") {
-            setMovementState(REACTING_NEUTRAL); 
-        } else if (command == "set_state:IDLE") {
-            setMovementState(IDLE); 
+    if (isBinaryProtocol()) {
+        uint8_t length;
+        const uint8_t *frame = readHostFrame(length);
+        if (frame) {
+            handleHostFrame(frame, length);
         }
+        return;
     }
+
+    const char *command = readSerialLine();
+    if (command && !dispatchSerialCommand(command, SERIAL_COMMANDS, NUM_SERIAL_COMMANDS)) {
+        reportLinkError(); // Unknown commands are usually bytes garbled on the wire
+    }
+}
+
+/**
+ * @brief  Acts on a binary frame from the host computer.
+ *
+ * @param   frame The opcode followed by the payload.
+ * @param   length The number of bytes in the frame.
+ */
+void handleHostFrame(const uint8_t *frame, uint8_t length) {
+    switch (frame[0]) {
+        case OPCODE_SET_STATE:
+            if (length == 2 && frame[1] <= REACTING_NEUTRAL) {
+                setMovementState((MovementState)frame[1]);
+            }
+            break;
+
+        case OPCODE_SET_TELEMETRY:
+            if (length == 2) {
+                setTelemetryMask(frame[1]);
+            }
+            break;
+
+        case OPCODE_TEXT_MODE:
+            setBinaryProtocol(false);
+            break;
+
+        case OPCODE_UPLOAD_MOVEMENT:
+            if (length == 15) {
+                MovementSet movement;
+                memcpy(&movement.amplitude, frame + 2, sizeof(float));
+                memcpy(&movement.centerAngle, frame + 6, sizeof(float));
+                memcpy(&movement.speedFactor, frame + 10, sizeof(float));
+                movement.waveform = (WaveformId)frame[14];
+                bool staged = stageMovementSet((MovementState)frame[1], movement);
+                sendMovementResult(staged ? MOVEMENT_STAGED : MOVEMENT_REJECTED);
+            }
+            break;
+
+        case OPCODE_ACTIVATE_MOVEMENTS:
+            activateUploadedMovements();
+            break;
+
+        case OPCODE_DEFAULT_MOVEMENTS:
+            stageDefaultMovementSets();
+            sendMovementResult(MOVEMENT_STAGED);
+            break;
+
+        default:
+            reportLinkError();
+            break;
+    }
+}
+
+/**
+ * @brief  Switches the movement state on a set_state command.
+ *
+ * @param   state The MovementState stored in the command table.
+ * @param   arguments Unused.
+ */
+void handleSetStateCommand(int state, const char *arguments) {
+    setMovementState((MovementState)state);
+}
+
+/**
+ * @brief  Reports the frame scheduler statistics on a stats:frames command.
+ *
+ * @param   value Unused.
+ * @param   arguments Unused.
+ */
+void handleFrameStatsCommand(int value, const char *arguments) {
+    printFrameStats();
+}
+
+#ifdef LOOP_PROFILING
+/**
+ * @brief  Reports the loop timing histograms on a stats command.
+ *
+ * @param   value Unused.
+ * @param   arguments Unused.
+ */
+void handleStatsCommand(int value, const char *arguments) {
+    printProfileStats();
+}
+#endif
+
+/**
+ * @brief  Switches the host link to binary frames on a protocol:binary command.
+ *
+ * @details The acknowledgement is the last text line sent before the switch.
+ *
+ * @param   value Unused.
+ * @param   arguments Unused.
+ */
+void handleProtocolCommand(int value, const char *arguments) {
+    Serial.println(F("protocol:binary"));
+    setBinaryProtocol(true);
+}
+
+/**
+ * @brief  Stages an uploaded movement set on a movement: command.
+ *
+ * @details The arguments are the state id, amplitude, center angle, speed
+ * factor and waveform id, for example "movement:3,5,120,2.5,1". The set is
+ * checked against the leaves' limits and only takes effect once the staged
+ * sets are activated.
+ *
+ * @param   value Unused.
+ * @param   arguments The five comma-separated values.
+ */
+void handleUploadMovementCommand(int value, const char *arguments) {
+    float values[5];
+    bool staged = false;
+
+    // Range check before the casts, which would wrap a huge id to a valid-looking one
+    if (parseNumberList(arguments, values, 5)
+        && values[0] >= 0 && values[0] < NUM_MOVEMENT_STATES
+        && values[4] >= 0 && values[4] < NUM_WAVEFORMS) {
+        MovementSet movement = {values[1], values[2], values[3], (WaveformId)(int)values[4]};
+        staged = stageMovementSet((MovementState)(int)values[0], movement);
+    }
+    sendMovementResult(staged ? MOVEMENT_STAGED : MOVEMENT_REJECTED);
+}
+
+/**
+ * @brief  Activates the staged movement sets on a movements:activate command.
+ *
+ * @param   value Unused.
+ * @param   arguments Unused.
+ */
+void handleActivateMovementsCommand(int value, const char *arguments) {
+    activateUploadedMovements();
+}
+
+/**
+ * @brief  Stages the built-in movement sets on a movements:defaults command.
+ *
+ * @param   value Unused.
+ * @param   arguments Unused.
+ */
+void handleDefaultMovementsCommand(int value, const char *arguments) {
+    stageDefaultMovementSets();
+    sendMovementResult(MOVEMENT_STAGED);
+}
+
+/**
+ * @brief  Swaps in the staged movement sets and blends to the new current one.
+ */
+void activateUploadedMovements() {
+    activateMovementSets();
+    startMovementTransition(getMovementSet(movementState));
+    sendMovementResult(MOVEMENTS_ACTIVE);
+}
+
+/**
+ * @brief  Streams the latest sensor distances to a binary host.
+ *
+ * @details An out-of-range reading is sent as DISTANCE_OUT_OF_RANGE_MM,
+ * 0xFFFF.
+ *
+ * @param   approachMm Raw approach sensor reading in mm, before the filter.
+ * @param   interactionMm Raw interaction sensor reading in mm, before the filter.
+ */
+void sendDistanceTelemetry(uint16_t approachMm, uint16_t interactionMm) {
+    uint8_t payload[4] = {
+        (uint8_t)approachMm, (uint8_t)(approachMm >> 8),
+        (uint8_t)interactionMm, (uint8_t)(interactionMm >> 8)
+    };
+    sendHostFrame(OPCODE_DISTANCES, payload, sizeof(payload));
+}
+
+/**
+ * @brief  Streams one leaf's phase and servo pulse to a binary host.
+ *
+ * @details Sent every frame for every leaf, so the host should only turn
+ * this on when the baud rate leaves room for it.
+ *
+ * @param   leafIndex The index of the leaf.
+ * @param   phase The leaf's current phase (2^32 per turn).
+ * @param   pulseTicks The pulse sent to the leaf's servo, in PCA9685 ticks.
+ */
+void sendLeafTelemetry(int leafIndex, uint32_t phase, uint16_t pulseTicks) {
+    uint16_t phaseHigh = phase >> 16;
+    uint8_t payload[5] = {
+        (uint8_t)leafIndex,
+        (uint8_t)phaseHigh, (uint8_t)(phaseHigh >> 8),
+        (uint8_t)pulseTicks, (uint8_t)(pulseTicks >> 8)
+    };
+    sendHostFrame(OPCODE_LEAF_STATE, payload, sizeof(payload));
+}
+
+#ifdef BENCHMARK
+/**
+ * @brief  Times the main firmware functions and reports them as JSON.
+ *
+ * @details updateLeafMovement() is given a full frame period before each
+ * call so every timed call computes and sends a frame. userDetection() and
+ * loop() are timed back to back, so their maximum is a call that starts a
+ * ping or sends a frame and their average is the typical pass.
+ */
+void runFirmwareBenchmarks() {
+    // Finish the startup ramp first so every timed call animates, and so
+    // its ready event is sent before the report starts
+    while (!leavesReady) {
+        updateLeafMovement();
+        delay(STARTUP_LEAF_INTERVAL_MS);
+    }
+
+    initializeBenchmark();
+
+    benchmarkFunction(F("moveLeaf"), []() {
+        moveLeaf(currentPhases[0], 0);
+    }, BENCHMARK_ITERATIONS);
+
+    benchmarkFunction(F("sineQ15"), []() {
+        // Step to a different table entry each call, feeding the result back
+        // in so the lookup cannot be optimized away
+        static volatile uint32_t phase = 0;
+        phase = phase + 0x01010101 + sineQ15(phase);
+    }, BENCHMARK_ITERATIONS);
+
+    benchmarkFunction(F("evaluateWaveform"), []() {
+        static volatile uint32_t phase = 0;
+        phase = phase + 0x01010101 + evaluateWaveform(WAVEFORM_SHIVER, phase);
+    }, BENCHMARK_ITERATIONS);
+
+    benchmarkFunction(F("mapFloat"), []() {
+        // An identity map keeps the input, and its cost, the same every call
+        static volatile float value = 0.25;
+        value = mapFloat(value, -1.0, 1.0, -1.0, 1.0);
+    }, BENCHMARK_ITERATIONS);
+
+    benchmarkFunction(F("updateLeafMovement"), updateLeafMovement,
+                      BENCHMARK_ITERATIONS, 1000000UL / MOTION_FRAME_RATE_HZ);
+
+    benchmarkFunction(F("filterDistance"), []() {
+        // Alternate readings so the gate, median and average all do work
+        static volatile uint16_t distance = 500;
+        distance = filterDistance(APPROACH_SENSOR, distance < 600 ? 800 : 400);
+    }, BENCHMARK_ITERATIONS);
+
+    benchmarkFunction(F("userDetection"), userDetection, BENCHMARK_ITERATIONS);
+
+    benchmarkFunction(F("loop"), loop, BENCHMARK_ITERATIONS);
+
+    finishBenchmark();
 }
+#endif
@@ -0,0 +1,235 @@
+/**
+ * @file        motion_kernel.cpp
+ * @author      Simon Håkansson
+ * @date        2025-09-04
+ * @brief       Fixed-point waveform kernel for the leaf animation.
+ *
+ * @details     The table holds one full sine period in 256 steps plus a
+ * closing entry, so interpolation never needs to wrap the index. The top 8
+ * bits of the phase select the step and the next 8 bits interpolate within it.
+ * Worst-case error against sin() is about 5 LSB in Q15 (1.6e-4).
+ *
+ *              The other waveforms in config.h, sums of harmonics or
+ *              keyframe curves, are sampled into tables of the same layout by
+ *              the compiler, so any waveform is evaluated exactly like the
+ *              sine: two flash reads and one multiply.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+//-------------[ LIBRARIES ]-------------
+#include <hal.h>
+#include <config.h>
+#include <index_sequence.h>
+#include <motion_kernel.h>
+
+//-------------[ WAVEFORM GENERATION ]-------------
+// Entries in every waveform table: 256 steps plus a closing entry
+const int WAVEFORM_POINTS = 257;
+
+constexpr double TWO_PI_RADIANS = 6.283185307179586;
+
+template <int N> struct WaveformTable {
+  int16_t points[N];
+};
+
+/**
+ * @brief  Rounds a value in [-1, 1] to Q15, saturating outside that range.
+ */
+constexpr int16_t toQ15(double value) {
+  return value >= 1.0 ? 32767
+       : value <= -1.0 ? -32767
+       : (int16_t)(value * 32767 + (value < 0 ? -0.5 : 0.5));
+}
+
+/**
+ * @brief  Sums the Taylor series of sin() from the term of order 2n + 1.
+ */
+constexpr double sineSeries(double squared, double term, int n) {
+  return n == 10 ? term : term + sineSeries(squared, -term * squared / ((2 * n + 2) * (2 * n + 3)), n + 1);
+}
+
+/**
+ * @brief  Moves an angle in (-2 PI, 2 PI) into [-PI, PI].
+ */
+constexpr double centerRadians(double radians) {
+  return radians > TWO_PI_RADIANS / 2 ? radians - TWO_PI_RADIANS
+       : radians < -TWO_PI_RADIANS / 2 ? radians + TWO_PI_RADIANS
+       : radians;
+}
+
+/**
+ * @brief  Evaluates sin() at compile time for an angle in [-PI, PI].
+ */
+constexpr double reducedSine(double radians) {
+  return sineSeries(radians * radians, radians, 0);
+}
+
+/**
+ * @brief  Evaluates sin() at compile time.
+ */
+constexpr double constantSine(double radians) {
+  return reducedSine(centerRadians(radians - TWO_PI_RADIANS * (int32_t)(radians / TWO_PI_RADIANS)));
+}
+
+/**
+ * @brief  Evaluates a sum of harmonics at an angle of the animation cycle.
+ */
+constexpr double harmonicSum(const Harmonic *harmonics, int count, double angle) {
+  return count == 0 ? 0.0
+       : harmonics[0].amplitude * constantSine(harmonics[0].multiple * angle + harmonics[0].phase)
+         + harmonicSum(harmonics + 1, count - 1, angle);
+}
+
+/**
+ * @brief  Adds up the amplitudes of a set of harmonics, the most they can reach.
+ */
+constexpr double harmonicPeak(const Harmonic *harmonics, int count) {
+  return count == 0 ? 0.0
+       : (harmonics[0].amplitude < 0 ? -harmonics[0].amplitude : harmonics[0].amplitude)
+         + harmonicPeak(harmonics + 1, count - 1);
+}
+
+/**
+ * @brief  Interpolates between keyframe k and the next one.
+ */
+constexpr double blendKeyframes(const float *keyframes, int k, double fraction) {
+  return keyframes[k] + (keyframes[k + 1] - keyframes[k]) * fraction;
+}
+
+/**
+ * @brief  Samples a keyframe curve at a position counted in keyframe steps.
+ */
+constexpr double sampleKeyframes(const float *keyframes, int segments, double position) {
+  return position >= segments ? keyframes[segments]
+       : blendKeyframes(keyframes, (int)position, position - (int)position);
+}
+
+template <int... I>
+constexpr WaveformTable<sizeof...(I)> buildHarmonicTable(const Harmonic *harmonics, int count, IndexSequence<I...>) {
+  return {{ toQ15(harmonicSum(harmonics, count, TWO_PI_RADIANS * I / (WAVEFORM_POINTS - 1)))... }};
+}
+
+template <int... I>
+constexpr WaveformTable<sizeof...(I)> buildKeyframeTable(const float *keyframes, int segments, IndexSequence<I...>) {
+  return {{ toQ15(sampleKeyframes(keyframes, segments, (double)I * segments / (WAVEFORM_POINTS - 1)))... }};
+}
+
+const int NUM_SHIVER_HARMONICS = sizeof(SHIVER_HARMONICS) / sizeof(SHIVER_HARMONICS[0]);
+const int BLOOM_SEGMENTS = sizeof(BLOOM_KEYFRAMES) / sizeof(BLOOM_KEYFRAMES[0]) - 1;
+
+static_assert(harmonicPeak(SHIVER_HARMONICS, NUM_SHIVER_HARMONICS) < 1.001, // Float rounding aside
+              "SHIVER_HARMONICS amplitudes must sum to 1 or less");
+static_assert(BLOOM_SEGMENTS >= 1 && BLOOM_KEYFRAMES[0] == BLOOM_KEYFRAMES[BLOOM_SEGMENTS],
+              "BLOOM_KEYFRAMES must end on its first keyframe");
+
+//-------------[ LOOKUP TABLES ]-------------
+// round(32767 * sin(2 PI i / 256)) for i = 0..256
+static const int16_t SINE_TABLE_Q15[257] PROGMEM = {
+       0,    804,   1608,   2410,   3212,   4011,   4808,   5602,
+    6393,   7179,   7962,   8739,   9512,  10278,  11039,  11793,
+   12539,  13279,  14010,  14732,  15446,  16151,  16846,  17530,
+   18204,  18868,  19519,  20159,  20787,  21403,  22005,  22594,
+   23170,  23731,  24279,  24811,  25329,  25832,  26319,  26790,
+   27245,  27683,  28105,  28510,  28898,  29268,  29621,  29956,
+   30273,  30571,  30852,  31113,  31356,  31580,  31785,  31971,
+   32137,  32285,  32412,  32521,  32609,  32678,  32728,  32757,
+   32767,  32757,  32728,  32678,  32609,  32521,  32412,  32285,
+   32137,  31971,  31785,  31580,  31356,  31113,  30852,  30571,
+   30273,  29956,  29621,  29268,  28898,  28510,  28105,  27683,
+   27245,  26790,  26319,  25832,  25329,  24811,  24279,  23731,
+   23170,  22594,  22005,  21403,  20787,  20159,  19519,  18868,
+   18204,  17530,  16846,  16151,  15446,  14732,  14010,  13279,
+   12539,  11793,  11039,  10278,   9512,   8739,   7962,   7179,
+    6393,   5602,   4808,   4011,   3212,   2410,   1608,    804,
+       0,   -804,  -1608,  -2410,  -3212,  -4011,  -4808,  -5602,
+   -6393,  -7179,  -7962,  -8739,  -9512, -10278, -11039, -11793,
+  -12539, -13279, -14010, -14732, -15446, -16151, -16846, -17530,
+  -18204, -18868, -19519, -20159, -20787, -21403, -22005, -22594,
+  -23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790,
+  -27245, -27683, -28105, -28510, -28898, -29268, -29621, -29956,
+  -30273, -30571, -30852, -31113, -31356, -31580, -31785, -31971,
+  -32137, -32285, -32412, -32521, -32609, -32678, -32728, -32757,
+  -32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285,
+  -32137, -31971, -31785, -31580, -31356, -31113, -30852, -30571,
+  -30273, -29956, -29621, -29268, -28898, -28510, -28105, -27683,
+  -27245, -26790, -26319, -25832, -25329, -24811, -24279, -23731,
+  -23170, -22594, -22005, -21403, -20787, -20159, -19519, -18868,
+  -18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+  -12539, -11793, -11039, -10278,  -9512,  -8739,  -7962,  -7179,
+   -6393,  -5602,  -4808,  -4011,  -3212,  -2410,  -1608,   -804,
+       0,
+};
+
+static const WaveformTable<WAVEFORM_POINTS> SHIVER_TABLE PROGMEM =
+    buildHarmonicTable(SHIVER_HARMONICS, NUM_SHIVER_HARMONICS, MakeIndexSequence<WAVEFORM_POINTS>::type());
+
+static const WaveformTable<WAVEFORM_POINTS> BLOOM_TABLE PROGMEM =
+    buildKeyframeTable(BLOOM_KEYFRAMES, BLOOM_SEGMENTS, MakeIndexSequence<WAVEFORM_POINTS>::type());
+
+// Indexed by WaveformId
+static const int16_t *const WAVEFORM_TABLES[NUM_WAVEFORMS] PROGMEM = {
+  SINE_TABLE_Q15,
+  SHIVER_TABLE.points,
+  BLOOM_TABLE.points,
+};
+
+//-------------[ FUNCTION PROTOTYPES ]-------------
+static inline int16_t interpolateTable(const int16_t *table, uint32_t phase);
+
+//-------------[ PUBLIC FUNCTIONS ]-------------
+/**
+ * @brief  Evaluates sin() of a binary angle in Q15.
+ *
+ * @param   phase The phase, where 2^32 is a full turn.
+ *
+ * @return  The sine value scaled to [-32767, 32767].
+ */
+int16_t sineQ15(uint32_t phase) {
+  return interpolateTable(SINE_TABLE_Q15, phase);
+}
+
+/**
+ * @brief  Evaluates one of the configured waveforms in Q15.
+ *
+ * @param   waveform The waveform to evaluate.
+ * @param   phase The phase, where 2^32 is a full cycle.
+ *
+ * @return  The waveform value scaled to [-32767, 32767].
+ */
+int16_t evaluateWaveform(WaveformId waveform, uint32_t phase) {
+  const int16_t *table = (const int16_t *)pgm_read_ptr(&WAVEFORM_TABLES[waveform]);
+  return interpolateTable(table, phase);
+}
+
+/**
+ * @brief  Converts an angle in radians to a binary angle phase.
+ *
+ * @param   radians The angle to convert, in [0, 2 PI).
+ *
+ * @return  The phase, where 2^32 is a full turn.
+ */
+uint32_t radiansToPhase(float radians) {
+  return (uint32_t)(radians * PHASE_UNITS_PER_RADIAN);
+}
+
+//-------------[ HELPER FUNCTIONS ]-------------
+/**
+ * @brief  Interpolates a 257-entry Q15 table in flash at a binary angle.
+ *
+ * @param   table The table, one cycle in 256 steps plus a closing entry.
+ * @param   phase The phase, where 2^32 is a full cycle.
+ *
+ * @return  The interpolated table value.
+ */
+static inline int16_t interpolateTable(const int16_t *table, uint32_t phase) {
+  uint8_t index = phase >> 24;
+  uint8_t fraction = phase >> 16;
+
+  int16_t a = pgm_read_word(&table[index]);
+  int16_t b = pgm_read_word(&table[index + 1]);
+
+  return a + (((int32_t)(b - a) * fraction) >> 8);
+}
@@ -0,0 +1,273 @@
+/**
+ * @file        movement_store.cpp
+ * @author      Simon Håkansson
+ * @date        2025-10-03
+ * @brief       Movement sets the host can replace at runtime, kept in EEPROM.
+ *
+ * @details     The EEPROM area is a ring of slots, each holding a whole bank
+ * with a sequence number and a CRC8. A save goes to the slot after the
+ * newest one, so an interrupted write only ever damages a slot that is not
+ * in use and the previous bank is loaded instead. At boot every slot is read
+ * once, which takes well under a millisecond; a blank or corrupt store, or
+ * one holding sets outside the leaves' limits, falls back to the sets in
+ * config.h.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+//-------------[ LIBRARIES ]-------------
+#include <stddef.h>
+#include <hal.h>
+#include <config.h>
+#include <host_protocol.h>
+#include <movement_store.h>
+
+//-------------[ INITIALIZATION ]-------------
+// One saved bank of movement sets, as laid out in an EEPROM slot
+struct MovementRecord {
+  MovementSet sets[NUM_MOVEMENT_STATES];
+  uint8_t version;
+  uint8_t sequence; // Counts up with every save, wrapping
+  uint8_t crc; // CRC8 of everything above
+};
+
+// Bytes covered by the CRC, and bytes saved per record. Padding the
+// compiler may add after the CRC is left out.
+const uint8_t MOVEMENT_RECORD_CRC_LENGTH = offsetof(MovementRecord, crc);
+const uint8_t MOVEMENT_RECORD_LENGTH = MOVEMENT_RECORD_CRC_LENGTH + 1;
+const uint8_t MOVEMENT_STORE_SLOTS = MOVEMENT_STORE_LENGTH / MOVEMENT_RECORD_LENGTH;
+
+static_assert(sizeof(MovementRecord) < 256, "Movement record too long for crc8()");
+static_assert(MOVEMENT_STORE_SLOTS >= 2, "The movement store needs room for two records");
+
+
+// The bank the animation reads, kept as a ready-to-save record, and the
+// bank uploads are written to
+static MovementRecord activeRecord;
+static MovementSet stagedSets[NUM_MOVEMENT_STATES];
+
+// Slot and sequence of the newest complete record in EEPROM, -1 if none
+static int storedSlot = -1;
+static uint8_t storedSequence = 0;
+
+// Background save of activeRecord, one byte at a time
+static bool savePending = false;
+static uint8_t saveSlot = 0;
+static uint8_t saveOffset = 0;
+
+//-------------[ FUNCTION PROTOTYPES ]-------------
+static bool readMovementRecord(uint8_t slot, MovementRecord &record);
+static uint16_t getSlotAddress(uint8_t slot);
+
+//-------------[ ANGLE LIMITS ]-------------
+/**
+ * @brief  Finds the lowest angle every leaf can reach.
+ */
+constexpr int commonMinAngle(int leafIndex = 0, int angle = 0) {
+  return leafIndex == NUM_LEAVES ? angle
+       : commonMinAngle(leafIndex + 1, LEAF_RANGES[leafIndex].minAngle > angle ? LEAF_RANGES[leafIndex].minAngle : angle);
+}
+
+/**
+ * @brief  Finds the highest angle every leaf can reach.
+ */
+constexpr int commonMaxAngle(int leafIndex = 0, int angle = SERVO_MAX_ANGLE) {
+  return leafIndex == NUM_LEAVES ? angle
+       : commonMaxAngle(leafIndex + 1, LEAF_RANGES[leafIndex].maxAngle < angle ? LEAF_RANGES[leafIndex].maxAngle : angle);
+}
+
+// The span of LEAF_RANGES that all leaves share
+constexpr int MOVEMENT_MIN_ANGLE = commonMinAngle();
+constexpr int MOVEMENT_MAX_ANGLE = commonMaxAngle();
+static_assert(MOVEMENT_MIN_ANGLE <= MOVEMENT_MAX_ANGLE, "LEAF_RANGES have no angle in common");
+
+/**
+ * @brief  Checks a movement set against the leaves' limits.
+ *
+ * @details The whole swing must stay inside the range every leaf in
+ * LEAF_RANGES can follow. The comparisons are written so NaN fails them.
+ */
+constexpr bool fitsLeafRanges(const MovementSet &movement) {
+  return movement.amplitude >= 0
+      && movement.centerAngle - movement.amplitude >= MOVEMENT_MIN_ANGLE
+      && movement.centerAngle + movement.amplitude <= MOVEMENT_MAX_ANGLE
+      && movement.speedFactor > 0
+      && movement.speedFactor <= MAX_MOVEMENT_SPEED_FACTOR
+      && (unsigned int)movement.waveform < NUM_WAVEFORMS;
+}
+
+/**
+ * @brief  Checks every set of a bank against the leaves' limits.
+ */
+constexpr bool fitLeafRanges(const MovementSet *sets, int count = NUM_MOVEMENT_STATES) {
+  return count == 0 || (fitsLeafRanges(sets[0]) && fitLeafRanges(sets + 1, count - 1));
+}
+
+// Built-in sets, indexed by MovementState
+static constexpr MovementSet DEFAULT_MOVEMENT_SETS[NUM_MOVEMENT_STATES] = {
+  IDLE_MOVEMENT, LISTEN_MOVEMENT, POSITIVE_MOVEMENT, NEGATIVE_MOVEMENT, NEUTRAL_MOVEMENT
+};
+static_assert(fitLeafRanges(DEFAULT_MOVEMENT_SETS), "A built-in movement set swings outside LEAF_RANGES");
+
+//-------------[ PUBLIC FUNCTIONS ]-------------
+/**
+ * @brief  Loads the newest saved bank, or the built-in sets if there is none.
+ *
+ * @details Call once from setup(). Both banks start out the same.
+ */
+void loadMovementSets() {
+  MovementRecord record;
+
+  storedSlot = -1;
+  for (uint8_t slot = 0; slot < MOVEMENT_STORE_SLOTS; slot++) {
+    if (!readMovementRecord(slot, record)) {
+      continue;
+    }
+    // Sequence numbers wrap, so newer means ahead by less than half the range
+    if (storedSlot < 0 || (int8_t)(record.sequence - storedSequence) > 0) {
+      storedSlot = slot;
+      storedSequence = record.sequence;
+      activeRecord = record;
+    }
+  }
+
+  if (storedSlot < 0) {
+    memcpy(activeRecord.sets, DEFAULT_MOVEMENT_SETS, sizeof(activeRecord.sets));
+  }
+  memcpy(stagedSets, activeRecord.sets, sizeof(stagedSets));
+  savePending = false;
+}
+
+/**
+ * @brief  Looks up the active movement parameters for a state.
+ *
+ * @param   state The movement state.
+ *
+ * @return  The movement set used while in that state.
+ */
+const MovementSet &getMovementSet(MovementState state) {
+  return activeRecord.sets[state < NUM_MOVEMENT_STATES ? state : IDLE];
+}
+
+/**
+ * @brief  Checks an uploaded movement set against the leaves' limits.
+ *
+ * @param   movement The movement set to check.
+ *
+ * @return  True if the set is safe to animate.
+ */
+bool isValidMovementSet(const MovementSet &movement) {
+  return fitsLeafRanges(movement);
+}
+
+/**
+ * @brief  Writes an uploaded movement set to the staged bank.
+ *
+ * @param   state The state the set is for.
+ * @param   movement The new movement parameters.
+ *
+ * @return  True if the set was valid and staged.
+ */
+bool stageMovementSet(MovementState state, const MovementSet &movement) {
+  if ((unsigned int)state >= NUM_MOVEMENT_STATES || !isValidMovementSet(movement)) {
+    return false;
+  }
+
+  stagedSets[state] = movement;
+  return true;
+}
+
+/**
+ * @brief  Replaces the staged bank with the built-in movement sets.
+ */
+void stageDefaultMovementSets() {
+  memcpy(stagedSets, DEFAULT_MOVEMENT_SETS, sizeof(stagedSets));
+}
+
+/**
+ * @brief  Makes the staged bank active and schedules it to be saved.
+ *
+ * @details Activating an unchanged bank does not write to the EEPROM. A save
+ * still in progress restarts in the same slot, which is not the newest.
+ */
+void activateMovementSets() {
+  if (memcmp(activeRecord.sets, stagedSets, sizeof(stagedSets)) == 0) {
+    return;
+  }
+
+  memcpy(activeRecord.sets, stagedSets, sizeof(stagedSets));
+  activeRecord.version = MOVEMENT_STORE_VERSION;
+  activeRecord.sequence = storedSequence + 1;
+  activeRecord.crc = crc8((const uint8_t *)&activeRecord, MOVEMENT_RECORD_CRC_LENGTH);
+
+  if (!savePending) {
+    saveSlot = storedSlot < 0 ? 0 : (storedSlot + 1) % MOVEMENT_STORE_SLOTS;
+  }
+  saveOffset = 0;
+  savePending = true;
+}
+
+/**
+ * @brief  Continues saving the active bank to EEPROM without blocking.
+ *
+ * @details An EEPROM byte takes about 3.3 ms to program. This writes at
+ * most one byte per call, and only once the previous one has finished, so
+ * it never waits. Call this every loop() pass.
+ */
+void updateMovementStore() {
+  if (!savePending || !eeprom_is_ready()) {
+    return;
+  }
+
+  const uint8_t *bytes = (const uint8_t *)&activeRecord;
+  EEPROM.update(getSlotAddress(saveSlot) + saveOffset, bytes[saveOffset]);
+
+  if (++saveOffset == MOVEMENT_RECORD_LENGTH) {
+    storedSlot = saveSlot;
+    storedSequence = activeRecord.sequence;
+    savePending = false;
+  }
+}
+
+//-------------[ HELPER FUNCTIONS ]-------------
+/**
+ * @brief  Reads one EEPROM slot and checks that it holds a usable record.
+ *
+ * @details A matching CRC only shows the record is complete. Its sets are
+ * validated as well, in case they were saved under different limits or a
+ * different layout without a change of MOVEMENT_STORE_VERSION.
+ *
+ * @param   slot The slot to read.
+ * @param   record Receives the slot's contents.
+ *
+ * @return  True if the record has the current version, a matching CRC and
+ *          only valid movement sets.
+ */
+static bool readMovementRecord(uint8_t slot, MovementRecord &record) {
+  uint8_t *bytes = (uint8_t *)&record;
+  uint16_t address = getSlotAddress(slot);
+
+  for (uint8_t i = 0; i < MOVEMENT_RECORD_LENGTH; i++) {
+    bytes[i] = EEPROM.read(address + i);
+  }
+
+  if (record.version != MOVEMENT_STORE_VERSION || record.crc != crc8(bytes, MOVEMENT_RECORD_CRC_LENGTH)) {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < NUM_MOVEMENT_STATES; i++) {
+    if (!isValidMovementSet(record.sets[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief  Returns the EEPROM address of a slot.
+ */
+static uint16_t getSlotAddress(uint8_t slot) {
+  return MOVEMENT_STORE_ADDRESS + slot * MOVEMENT_RECORD_LENGTH;
+}
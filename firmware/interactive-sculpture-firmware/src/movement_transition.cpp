@@ -0,0 +1,227 @@
+/**
+ * @file        movement_transition.cpp
+ * @author      Simon Håkansson
+ * @date        2025-09-29
+ * @brief       Eased cross-fades between movement sets and servo slew limits.
+ *
+ * @details     The slew limiter keeps each leaf's last pulse in Q4 ticks, so
+ * limits below one tick per frame still average out correctly. A pulse of 0
+ * marks a leaf that has not been driven yet; its first pulse goes through
+ * unchanged.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+//-------------[ LIBRARIES ]-------------
+#include <hal.h>
+#include <config.h>
+#include <leaf_config.h>
+#include <motion_kernel.h>
+#include <movement_transition.h>
+
+//-------------[ INITIALIZATION ]-------------
+// Parameters the animation uses right now
+static MovementSet activeMovement = IDLE_MOVEMENT;
+
+// Endpoints and start time of the running transition
+static MovementSet transitionFrom;
+static MovementSet transitionTo;
+static unsigned long transitionStart = 0;
+static bool transitionRunning = false;
+
+// Waveform being faded out, the weight of the active one in Q8, and when
+// the fade started. A waveform asked for while a fade runs waits in
+// pendingWaveform until that fade is done.
+static WaveformId previousWaveform = WAVEFORM_SINE;
+static WaveformId pendingWaveform = WAVEFORM_SINE;
+static uint16_t waveformWeightQ8 = 256;
+static unsigned long waveformFadeStart = 0;
+
+// Last pulse of every leaf after slew limiting, in Q4 ticks
+static uint16_t slewTicksQ4[NUM_LEAVES];
+
+//-------------[ FUNCTION PROTOTYPES ]-------------
+static float easeTransition(float progress);
+static float blend(float from, float to, float weight);
+static void startWaveformFade(WaveformId waveform);
+static void updateWaveformFade();
+
+//-------------[ PUBLIC FUNCTIONS ]-------------
+/**
+ * @brief  Switches to a movement set at once, cancelling any transition.
+ *
+ * @param   movement The movement set to use.
+ */
+void setActiveMovement(const MovementSet &movement) {
+  activeMovement = movement;
+  transitionRunning = false;
+  pendingWaveform = movement.waveform;
+  waveformWeightQ8 = 256;
+}
+
+/**
+ * @brief  Starts blending from the current parameters towards a movement set.
+ *
+ * @details The new waveform fades in over the old one. If a waveform fade is
+ * still running, it is finished first and the new waveform fades in after
+ * it, so the blended shape never jumps.
+ *
+ * @param   target The movement set to end up in.
+ */
+void startMovementTransition(const MovementSet &target) {
+  transitionFrom = activeMovement;
+  transitionTo = target;
+  transitionStart = millis();
+  transitionRunning = true;
+
+  pendingWaveform = target.waveform;
+  if (waveformWeightQ8 >= 256) {
+    startWaveformFade(pendingWaveform);
+  }
+}
+
+/**
+ * @brief  Advances the running transition. Call once per motion frame.
+ *
+ * @return  True if the amplitude, center angle or speed factor changed.
+ */
+bool updateMovementTransition() {
+  updateWaveformFade();
+
+  if (!transitionRunning) {
+    return false;
+  }
+
+  float weight = 1;
+  unsigned long elapsed = millis() - transitionStart;
+  if (elapsed >= MOVEMENT_TRANSITION_MS) {
+    transitionRunning = false;
+  } else {
+    weight = easeTransition((float)elapsed / MOVEMENT_TRANSITION_MS);
+  }
+
+  activeMovement.amplitude = blend(transitionFrom.amplitude, transitionTo.amplitude, weight);
+  activeMovement.centerAngle = blend(transitionFrom.centerAngle, transitionTo.centerAngle, weight);
+  activeMovement.speedFactor = blend(transitionFrom.speedFactor, transitionTo.speedFactor, weight);
+  return true;
+}
+
+/**
+ * @brief  Returns the movement parameters in effect.
+ *
+ * @return  The blended movement set.
+ */
+const MovementSet &getActiveMovement() {
+  return activeMovement;
+}
+
+/**
+ * @brief  Evaluates the active waveform, cross-faded during a transition.
+ *
+ * @details Outside a change of waveform this costs one table lookup.
+ *
+ * @param   phase The leaf's phase (2^32 per cycle).
+ *
+ * @return  The waveform value in Q15.
+ */
+int16_t sampleActiveWaveform(uint32_t phase) {
+  int16_t sample = evaluateWaveform(activeMovement.waveform, phase);
+  if (waveformWeightQ8 >= 256) {
+    return sample;
+  }
+
+  int16_t previous = evaluateWaveform(previousWaveform, phase);
+  return previous + (((int32_t)(sample - previous) * waveformWeightQ8) >> 8);
+}
+
+/**
+ * @brief  Moves a leaf's pulse towards a target no faster than its slew limit.
+ *
+ * @details Call exactly once per leaf per motion frame.
+ *
+ * @param   leafIndex The index of the leaf.
+ * @param   ticks The pulse the animation asks for, in PCA9685 ticks.
+ *
+ * @return  The pulse to send, in PCA9685 ticks.
+ */
+uint16_t limitServoSlew(uint8_t leafIndex, uint16_t ticks) {
+  uint16_t targetQ4 = ticks << 4;
+  uint16_t &currentQ4 = slewTicksQ4[leafIndex];
+
+  if (currentQ4 == 0) {
+    currentQ4 = targetQ4;
+    return ticks;
+  }
+
+  uint16_t maxStep = getLeafMaxSlew(leafIndex);
+  if (targetQ4 > currentQ4 + maxStep) {
+    currentQ4 += maxStep;
+  } else if (targetQ4 + maxStep < currentQ4) {
+    currentQ4 -= maxStep;
+  } else {
+    currentQ4 = targetQ4;
+  }
+  return (currentQ4 + 8) >> 4;
+}
+
+//-------------[ HELPER FUNCTIONS ]-------------
+/**
+ * @brief  Shapes the progress of a transition with the configured easing curve.
+ *
+ * @param   progress Elapsed fraction of the transition, 0 to 1.
+ *
+ * @return  The blend weight of the target set, 0 to 1.
+ */
+static float easeTransition(float progress) {
+  switch (MOVEMENT_TRANSITION_EASING) {
+    case EASE_SMOOTHSTEP:
+      return progress * progress * (3 - 2 * progress);
+    case EASE_SMOOTHERSTEP:
+      return progress * progress * progress * (progress * (progress * 6 - 15) + 10);
+    case EASE_LINEAR:
+    default:
+      return progress;
+  }
+}
+
+/**
+ * @brief  Interpolates linearly between two values.
+ */
+static float blend(float from, float to, float weight) {
+  return from + (to - from) * weight;
+}
+
+/**
+ * @brief  Starts fading a waveform in over the active one.
+ *
+ * @param   waveform The waveform to fade in, nothing happens if it is active.
+ */
+static void startWaveformFade(WaveformId waveform) {
+  if (waveform == activeMovement.waveform) {
+    return;
+  }
+  previousWaveform = activeMovement.waveform;
+  activeMovement.waveform = waveform;
+  waveformWeightQ8 = 0;
+  waveformFadeStart = millis();
+}
+
+/**
+ * @brief  Advances the waveform fade and starts the pending one once it ends.
+ */
+static void updateWaveformFade() {
+  if (waveformWeightQ8 >= 256) {
+    return;
+  }
+
+  unsigned long elapsed = millis() - waveformFadeStart;
+  if (elapsed < MOVEMENT_TRANSITION_MS) {
+    waveformWeightQ8 = easeTransition((float)elapsed / MOVEMENT_TRANSITION_MS) * 256;
+    return;
+  }
+
+  waveformWeightQ8 = 256;
+  startWaveformFade(pendingWaveform);
+}
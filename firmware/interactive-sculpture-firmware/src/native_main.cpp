@@ -0,0 +1,241 @@
+/**
+ * @file        native_main.cpp
+ * @author      Simon Håkansson
+ * @date        2025-09-19
+ * @brief       Entry point of the native firmware build.
+ *
+ * @details     Runs setup() and loop() against the simulated hardware for a
+ * given stretch of simulated time. Serial output goes to stdout and a short
+ * summary goes to stderr.
+ *
+ *              Options:
+ *                --duration-ms <ms>      Simulated run time (default 10000, or
+ *                                        until TRACE_TAIL_MS after a trace ends)
+ *                --step-us <us>          Simulated time per loop() pass (default 100)
+ *                --approach-cm <cm>      Approach sensor distance, 0 for no echo
+ *                --interaction-cm <cm>   Interaction sensor distance, 0 for no echo
+ *                --input <file>          Bytes the host sends at start-up
+ *                --max-speed <deg/s>     Exit with status 2 if any servo is
+ *                                        driven faster than this
+ *                --trace <file>          Replay recorded sensor distances
+ *                --serial-log <file>     Write each serial output line with
+ *                                        its simulated time in ms
+ *                --servo-log <file>      Write every servo command as
+ *                                        time_us,board,channel,ticks
+ *
+ *              Traces are replayed by trace_replay.cpp, which describes
+ *              the format. Recorded gallery data replays much faster than
+ *              real time, and the logs give the events and servo output to
+ *              compare between firmware versions.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+#if !defined(ARDUINO) && !defined(UNIT_TEST)
+
+//-------------[ LIBRARIES ]-------------
+#include <stdio.h>
+#include <hal.h>
+#include <config.h>
+#include <servo_calibration.h>
+#include <servo_output.h>
+#include <trace_replay.h>
+
+//-------------[ INITIALIZATION ]-------------
+// Last pulse and write time of every simulated channel, for the speed check
+static uint16_t channelTicks[SIM_PCA9685_BOARDS][16];
+static uint64_t channelTimes[SIM_PCA9685_BOARDS][16];
+static float peakServoSpeed = 0; // degrees per second
+
+// Simulated time to keep running after the last trace row, so the filter
+// and the user state dwell times can settle
+const unsigned long TRACE_TAIL_MS = 3000;
+
+// Log files, or nullptr
+static FILE *serialLog = nullptr;
+static FILE *servoLog = nullptr;
+
+// Serial output line being collected for the serial log
+static char serialLine[128];
+static size_t serialLineLength = 0;
+
+//-------------[ FUNCTION PROTOTYPES ]-------------
+void setup();
+void loop();
+static bool loadSerialInput(const char *path);
+static void trackServoSpeed(uint8_t address, uint8_t channel, uint16_t ticks);
+static void logSerialOutput(uint8_t c);
+static FILE *openOutput(const char *path);
+
+//-------------[ MAIN FUNCTION ]-------------
+int main(int argc, char **argv) {
+  unsigned long durationMs = 10000;
+  unsigned long stepUs = 100;
+  float approachCm = 0;
+  float interactionCm = 0;
+  const char *inputPath = nullptr;
+  float maxSpeed = 0;
+  bool durationSet = false;
+  const char *tracePath = nullptr;
+  const char *serialLogPath = nullptr;
+  const char *servoLogPath = nullptr;
+
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--duration-ms") == 0) {
+      durationMs = strtoul(argv[i + 1], nullptr, 10);
+      durationSet = true;
+    } else if (strcmp(argv[i], "--step-us") == 0) {
+      stepUs = strtoul(argv[i + 1], nullptr, 10);
+    } else if (strcmp(argv[i], "--approach-cm") == 0) {
+      approachCm = atof(argv[i + 1]);
+    } else if (strcmp(argv[i], "--interaction-cm") == 0) {
+      interactionCm = atof(argv[i + 1]);
+    } else if (strcmp(argv[i], "--input") == 0) {
+      inputPath = argv[i + 1];
+    } else if (strcmp(argv[i], "--max-speed") == 0) {
+      maxSpeed = atof(argv[i + 1]);
+    } else if (strcmp(argv[i], "--trace") == 0) {
+      tracePath = argv[i + 1];
+    } else if (strcmp(argv[i], "--serial-log") == 0) {
+      serialLogPath = argv[i + 1];
+    } else if (strcmp(argv[i], "--servo-log") == 0) {
+      servoLogPath = argv[i + 1];
+    } else {
+      fprintf(stderr, "Unknown option: %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  simReset();
+  simAttachUltrasonic(APPROACH_TRIG_PIN, APPROACH_ECHO_PIN);
+  simAttachUltrasonic(INTERACTION_TRIG_PIN, INTERACTION_ECHO_PIN);
+  simSetUltrasonicDistance(APPROACH_ECHO_PIN, approachCm);
+  simSetUltrasonicDistance(INTERACTION_ECHO_PIN, interactionCm);
+  if (inputPath && !loadSerialInput(inputPath)) {
+    fprintf(stderr, "Cannot read %s\n", inputPath);
+    return 1;
+  }
+  simSetServoListener(trackServoSpeed);
+
+  if (tracePath && !openTrace(tracePath)) {
+    fprintf(stderr, "Cannot read %s\n", tracePath);
+    return 1;
+  }
+  if ((serialLogPath && !(serialLog = openOutput(serialLogPath)))
+      || (servoLogPath && !(servoLog = openOutput(servoLogPath)))) {
+    return 1;
+  }
+  if (serialLog) {
+    simSetSerialOutput(logSerialOutput);
+  }
+
+  setup();
+
+  // Without a fixed duration a trace runs until it has been replayed. An
+  // empty trace runs out on the first pass, so it still ends.
+  bool tracing = tracePath != nullptr;
+  uint64_t end = tracing && !durationSet ? UINT64_MAX : (uint64_t)durationMs * 1000;
+
+  unsigned long loops = 0;
+  while (simMicros() < end) {
+    if (tracing && !updateTrace()) {
+      tracing = false;
+      if (!durationSet) {
+        end = simMicros() + TRACE_TAIL_MS * 1000UL;
+      }
+    }
+    loop();
+    simAdvanceMicros(stepUs);
+    loops++;
+  }
+
+  fprintf(stderr, "simulated %lu ms, %lu loop() passes, %lu I2C bytes in %lu transactions\n",
+          (unsigned long)(simMicros() / 1000), loops, simWireBytes(), simWireTransactions());
+  fprintf(stderr, "%lu unchanged servo writes skipped\n", getSkippedServoWrites());
+  if (tracePath) {
+    fprintf(stderr, "replayed %lu trace rows\n", getTraceRows());
+    closeTrace();
+  }
+  if (serialLog) {
+    fclose(serialLog);
+  }
+  if (servoLog) {
+    fclose(servoLog);
+  }
+  fprintf(stderr, "peak servo speed %.1f deg/s\n", peakServoSpeed);
+
+  if (maxSpeed > 0 && peakServoSpeed > maxSpeed) {
+    fprintf(stderr, "servo speed limit of %.1f deg/s exceeded\n", maxSpeed);
+    return 2;
+  }
+  return 0;
+}
+
+//-------------[ HELPER FUNCTIONS ]-------------
+/**
+ * @brief  Queues the contents of a file as serial input from the host.
+ */
+static bool loadSerialInput(const char *path) {
+  FILE *file = fopen(path, "rb");
+  if (!file) {
+    return false;
+  }
+  char buffer[256];
+  size_t length;
+  while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    simSerialInput(buffer, length);
+  }
+  fclose(file);
+  return true;
+}
+
+/**
+ * @brief  Records the fastest servo movement between two writes to a channel.
+ */
+static void trackServoSpeed(uint8_t address, uint8_t channel, uint16_t ticks) {
+  uint8_t board = address - PCA9685_I2C_ADDRESS;
+  uint64_t now = simMicros();
+
+  if (servoLog) {
+    fprintf(servoLog, "%llu,%u,%u,%u\n", (unsigned long long)now, board, channel, ticks);
+  }
+
+  if (channelTicks[board][channel] != 0 && now > channelTimes[board][channel]) {
+    float degrees = abs((int)ticks - (int)channelTicks[board][channel]) * 256.0 / degreesToTicksQ8(1);
+    float seconds = (now - channelTimes[board][channel]) / 1000000.0;
+    peakServoSpeed = max(peakServoSpeed, degrees / seconds);
+  }
+
+  channelTicks[board][channel] = ticks;
+  channelTimes[board][channel] = now;
+}
+
+/**
+ * @brief  Passes serial output on to stdout and logs each line with its time.
+ */
+static void logSerialOutput(uint8_t c) {
+  putchar(c);
+
+  if (c == '\n') {
+    fprintf(serialLog, "%llu,%.*s\n", (unsigned long long)(simMicros() / 1000),
+            (int)serialLineLength, serialLine);
+    serialLineLength = 0;
+  } else if (c != '\r' && serialLineLength < sizeof(serialLine)) {
+    serialLine[serialLineLength++] = c;
+  }
+}
+
+/**
+ * @brief  Opens a log file for writing, reporting any failure.
+ */
+static FILE *openOutput(const char *path) {
+  FILE *file = fopen(path, "w");
+  if (!file) {
+    fprintf(stderr, "Cannot write %s\n", path);
+  }
+  return file;
+}
+
+#endif // !ARDUINO && !UNIT_TEST
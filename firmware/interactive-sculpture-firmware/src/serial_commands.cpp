@@ -0,0 +1,126 @@
+/**
+ * @file        serial_commands.cpp
+ * @author      Simon Håkansson
+ * @date        2025-09-12
+ * @brief       Non-blocking, allocation-free serial command parser.
+ *
+ * @details     Lines end with '\n'; a '\r' before it is ignored. A line
+ * longer than SERIAL_LINE_LENGTH is dropped as a whole rather than being
+ * cut into a different, possibly valid command.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+//-------------[ LIBRARIES ]-------------
+#include <hal.h>
+#include <link_speed.h>
+#include <serial_commands.h>
+
+//-------------[ INITIALIZATION ]-------------
+// The line being received and its length so far
+static char lineBuffer[SERIAL_LINE_LENGTH + 1];
+static uint8_t lineLength = 0;
+static bool lineOverflow = false;
+
+//-------------[ PUBLIC FUNCTIONS ]-------------
+/**
+ * @brief  Consumes waiting serial bytes and returns a line once complete.
+ *
+ * @details Reads at most SERIAL_BYTES_PER_POLL bytes and stops after the
+ * first completed line, so the rest is handled on the next call.
+ *
+ * @return  The completed line, valid until the next call, or nullptr.
+ */
+const char *readSerialLine() {
+  for (uint8_t i = 0; i < SERIAL_BYTES_PER_POLL && Serial.available() > 0; i++) {
+    char c = Serial.read();
+
+    if (c == '\r') {
+      continue;
+    }
+
+    if (c == '\n') {
+      bool complete = lineLength > 0 && !lineOverflow;
+      if (lineOverflow) {
+        reportLinkError();
+      }
+      lineBuffer[lineLength] = '\0';
+      lineLength = 0;
+      lineOverflow = false;
+      if (complete) {
+        return lineBuffer;
+      }
+      continue;
+    }
+
+    if (lineLength < SERIAL_LINE_LENGTH) {
+      lineBuffer[lineLength++] = c;
+    } else {
+      lineOverflow = true;
+    }
+  }
+
+  return nullptr;
+}
+
+/**
+ * @brief  Runs the handler of the table entry matching a line.
+ *
+ * @param   line The received command line.
+ * @param   commands The command table, stored in PROGMEM.
+ * @param   count The number of entries in the table.
+ *
+ * @return  True if an entry matched.
+ */
+bool dispatchSerialCommand(const char *line, const SerialCommand *commands, uint8_t count) {
+  for (uint8_t i = 0; i < count; i++) {
+    const char *name = commands[i].name;
+    size_t nameLength = strlen_P(name);
+    const char *arguments = nullptr;
+
+    if (nameLength > 0 && pgm_read_byte(name + nameLength - 1) == ':') {
+      if (strncmp_P(line, name, nameLength) == 0) {
+        arguments = line + nameLength;
+      }
+    } else if (strcmp_P(line, name) == 0) {
+      arguments = line + nameLength;
+    }
+
+    if (arguments) {
+      CommandHandler handler = (CommandHandler)pgm_read_ptr(&commands[i].handler);
+      int value = (int16_t)pgm_read_word(&commands[i].value);
+      handler(value, arguments);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * @brief  Parses exactly count comma-separated numbers from command arguments.
+ *
+ * @param   text The arguments, for example "25,90,1.5".
+ * @param   values Receives the numbers.
+ * @param   count The number of values expected.
+ *
+ * @return  True if the text held count numbers and nothing else.
+ */
+bool parseNumberList(const char *text, float *values, uint8_t count) {
+  for (uint8_t i = 0; i < count; i++) {
+    char *end;
+    values[i] = strtod(text, &end);
+    if (end == text) {
+      return false;
+    }
+    char separator = i + 1 < count ? ',' : '\0';
+    if (*end != separator) {
+      return false;
+    }
+    text = end + 1;
+  }
+
+  return true;
+}
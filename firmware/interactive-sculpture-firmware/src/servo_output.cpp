@@ -0,0 +1,160 @@
+/**
+ * @file        servo_output.cpp
+ * @author      Simon Håkansson
+ * @date        2025-09-08
+ * @brief       Batched PCA9685 output stage for the leaf servos.
+ *
+ * @details     The PCA9685 stores each channel in four consecutive registers
+ * (ON_L, ON_H, OFF_L, OFF_H) and the Adafruit driver enables register
+ * auto-increment. A run of neighbouring channels can therefore be written
+ * with a single register address followed by four bytes per channel. Runs
+ * are split to fit the Wire library's transmit buffer. The stage remembers
+ * the last tick count sent on each channel and only writes channels that
+ * changed, which matters most in slow states where most frames repeat.
+ *
+ *              Any number of chained boards is supported. The frame buffer
+ *              is kept per leaf in LEAF_PINS order, and a run continues as
+ *              long as the next leaf sits on the next channel of the same
+ *              board, which is worked out at compile time in LEAF_CONFIG.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+//-------------[ LIBRARIES ]-------------
+#include <hal.h>
+#include <config.h>
+#include <leaf_config.h>
+#include <servo_output.h>
+
+//-------------[ INITIALIZATION ]-------------
+// Channels that fit in one Wire transmission after the register address
+const uint8_t CHANNELS_PER_BURST = (BUFFER_LENGTH - 1) / 4;
+
+// Off-tick staged for every leaf, 0 until the leaf is first staged.
+// A servo pulse is never 0 ticks long, so 0 is free to mean "nothing".
+static uint16_t frameTicks[NUM_LEAVES];
+
+// Off-tick last written for every leaf, 0 until the first write
+static uint16_t sentTicks[NUM_LEAVES];
+
+// Number of channel writes left out because the pulse had not changed
+static unsigned long skippedServoWrites = 0;
+
+//-------------[ FUNCTION PROTOTYPES ]-------------
+static bool isLeafDirty(uint8_t leafIndex);
+static void writeChannelBurst(uint8_t firstLeaf, uint8_t count);
+
+//-------------[ PUBLIC FUNCTIONS ]-------------
+/**
+ * @brief  Initializes every PCA9685 servo driver and the I2C bus.
+ */
+void initializeServoOutput() {
+  for (int i = 0; i < NUM_LEAVES; i++) {
+
+    // Set each board up once, at its first leaf
+    bool seen = false;
+    for (int j = 0; j < i && !seen; j++) {
+      seen = getLeafBoard(j) == getLeafBoard(i);
+    }
+    if (seen) {
+      continue;
+    }
+
+    Adafruit_PWMServoDriver pwm = Adafruit_PWMServoDriver(getLeafBoard(i));
+    pwm.begin();
+    pwm.setOscillatorFrequency(PCA9685_OSCILLATOR_FREQUENCY);
+    pwm.setPWMFreq(SERVO_FREQUENCY);
+  }
+
+  // The PCA9685 supports fast-mode I2C, which shortens every burst
+  Wire.setClock(I2C_CLOCK_HZ);
+}
+
+/**
+ * @brief  Stages the pulse of one leaf's servo for the next frame.
+ *
+ * @param   leafIndex The index of the leaf.
+ * @param   ticks The tick count at which the pulse ends.
+ */
+void setServoTicks(uint8_t leafIndex, uint16_t ticks) {
+  frameTicks[leafIndex] = ticks;
+}
+
+/**
+ * @brief  Writes every changed channel to the PCA9685 boards right away.
+ */
+void flushServoFrame() {
+  uint8_t leaf = 0;
+  while (leaf < NUM_LEAVES) {
+
+    // Skip leaves without a change
+    if (!isLeafDirty(leaf)) {
+      if (frameTicks[leaf] != 0) {
+        skippedServoWrites++;
+      }
+      leaf++;
+      continue;
+    }
+
+    // Extend the run over neighbouring channels that changed
+    uint8_t count = 1;
+    while (leaf + count < NUM_LEAVES && count < CHANNELS_PER_BURST
+           && doesLeafContinueBurst(leaf + count) && isLeafDirty(leaf + count)) {
+      count++;
+    }
+
+    writeChannelBurst(leaf, count);
+    leaf += count;
+  }
+}
+
+/**
+ * @brief  Returns how many channel writes were skipped as redundant.
+ *
+ * @return  The number of skipped writes since boot.
+ */
+unsigned long getSkippedServoWrites() {
+  return skippedServoWrites;
+}
+
+//-------------[ HELPER FUNCTIONS ]-------------
+/**
+ * @brief  Checks whether a leaf's staged pulse still has to be written.
+ *
+ * @param   leafIndex The index of the leaf.
+ *
+ * @return  True if a pulse is staged and differs from the one last sent.
+ */
+static bool isLeafDirty(uint8_t leafIndex) {
+  return frameTicks[leafIndex] != sentTicks[leafIndex];
+}
+
+/**
+ * @brief  Writes a run of neighbouring channels in one I2C transmission.
+ *
+ * @details The channels only count as sent once the board has acknowledged
+ * the whole burst.
+ *
+ * @param   firstLeaf The leaf on the first channel of the run.
+ * @param   count The number of channels in the run.
+ */
+static void writeChannelBurst(uint8_t firstLeaf, uint8_t count) {
+  Wire.beginTransmission(getLeafBoard(firstLeaf));
+  Wire.write(PCA9685_LED0_ON_L + 4 * getLeafChannel(firstLeaf));
+
+  for (uint8_t i = 0; i < count; i++) {
+    uint16_t ticks = frameTicks[firstLeaf + i];
+    Wire.write(0);           // ON_L: pulse starts at tick 0
+    Wire.write(0);           // ON_H
+    Wire.write(ticks);       // OFF_L
+    Wire.write(ticks >> 8);  // OFF_H
+  }
+
+  // A burst the board did not acknowledge stays dirty and is sent again
+  if (Wire.endTransmission() != 0) {
+    return;
+  }
+  memcpy(&sentTicks[firstLeaf], &frameTicks[firstLeaf], count * sizeof(sentTicks[0]));
+}
@@ -0,0 +1,131 @@
+/**
+ * @file        trace_replay.cpp
+ * @author      Simon Håkansson
+ * @date        2025-09-19
+ * @brief       Replay of recorded sensor distances in the native build.
+ *
+ * @details     Only compiled when ARDUINO is not defined. The next row is
+ * read ahead, so updateTrace() can tell when the trace has run out as soon
+ * as its last row has been applied.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+#ifndef ARDUINO
+
+//-------------[ LIBRARIES ]-------------
+#include <stdio.h>
+#include <ctype.h>
+#include <hal.h>
+#include <config.h>
+#include <trace_replay.h>
+
+//-------------[ INITIALIZATION ]-------------
+// A recorded distance sample
+struct TraceRow {
+  unsigned long timeMs;
+  float approachCm;
+  float interactionCm;
+};
+
+// Trace being replayed or nullptr, when it was opened, its next row and
+// the rows applied so far
+static FILE *traceFile = nullptr;
+static uint64_t traceStart = 0;
+static TraceRow nextRow;
+static bool haveRow = false;
+static unsigned long traceRows = 0;
+
+//-------------[ FUNCTION PROTOTYPES ]-------------
+static bool readTraceRow(TraceRow &row);
+static float parseTraceDistance(const char *field);
+
+//-------------[ PUBLIC FUNCTIONS ]-------------
+/**
+ * @brief  Opens a trace and reads ahead to its first row.
+ *
+ * @param   path The trace file.
+ *
+ * @return  False if the file cannot be read.
+ */
+bool openTrace(const char *path) {
+  closeTrace();
+  if (!(traceFile = fopen(path, "r"))) {
+    return false;
+  }
+  traceStart = simMicros();
+  traceRows = 0;
+  haveRow = readTraceRow(nextRow);
+  return true;
+}
+
+/**
+ * @brief  Applies every row that is due at the current simulated time.
+ *
+ * @return  True while rows are left to apply, false once the trace has
+ *          been replayed or if none is open.
+ */
+bool updateTrace() {
+  while (haveRow && simMicros() - traceStart >= (uint64_t)nextRow.timeMs * 1000) {
+    simSetUltrasonicDistance(APPROACH_ECHO_PIN, nextRow.approachCm);
+    simSetUltrasonicDistance(INTERACTION_ECHO_PIN, nextRow.interactionCm);
+    traceRows++;
+    haveRow = readTraceRow(nextRow);
+  }
+  return haveRow;
+}
+
+/**
+ * @brief  Returns how many rows of the trace have been applied.
+ */
+unsigned long getTraceRows() {
+  return traceRows;
+}
+
+/**
+ * @brief  Closes the trace, if one is open.
+ */
+void closeTrace() {
+  if (traceFile) {
+    fclose(traceFile);
+    traceFile = nullptr;
+  }
+  haveRow = false;
+}
+
+//-------------[ HELPER FUNCTIONS ]-------------
+/**
+ * @brief  Reads the next sample from the trace, skipping other lines.
+ *
+ * @param   row Receives the sample.
+ *
+ * @return  False at the end of the trace.
+ */
+static bool readTraceRow(TraceRow &row) {
+  char line[128];
+
+  while (fgets(line, sizeof(line), traceFile)) {
+    if (!isdigit((unsigned char)line[0])) {
+      continue;
+    }
+    char *field = strchr(line, ',');
+    char *secondField = field ? strchr(field + 1, ',') : nullptr;
+    row.timeMs = strtoul(line, nullptr, 10);
+    row.approachCm = field ? parseTraceDistance(field + 1) : 0;
+    row.interactionCm = secondField ? parseTraceDistance(secondField + 1) : 0;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief  Converts a trace distance to the simulator's, 0 for no echo.
+ */
+static float parseTraceDistance(const char *field) {
+  float distanceCm = atof(field);
+  return isfinite(distanceCm) && distanceCm > 0 ? distanceCm : 0;
+}
+
+#endif // !ARDUINO
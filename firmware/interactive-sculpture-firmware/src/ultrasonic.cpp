@@ -0,0 +1,391 @@
+/**
+ * @file        ultrasonic.cpp
+ * @author      Simon Håkansson
+ * @date        2025-09-02
+ * @brief       Non-blocking ultrasonic ranging engine for the interactive sculpture.
+ *
+ * @details     Each sensor runs a small state machine. A ping raises the
+ * trigger pin for ULTRASONIC_TRIGGER_PULSE microseconds and returns. The
+ * pin-change interrupt timestamps the rising and falling edges of the echo,
+ * and the main loop only checks for completion or the sensor's echo
+ * deadline, which follows from its maximum range. The sensors of a ping
+ * slot are in flight together, triggered ULTRASONIC_STAGGER_US apart, and
+ * the slots run one after the other, so a ranging cycle takes one deadline
+ * per slot rather than per sensor.
+ *
+ * A sensor can time another sensor's burst instead of its own echo, which
+ * reads short. The trigger order within a slot reverses every cycle, so
+ * such a reading does not repeat from one cycle to the next and is held
+ * back until the next cycle confirms it, see publishUltrasonicReading().
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+//-------------[ LIBRARIES ]-------------
+#include <hal.h>
+#include <config.h>
+#include <ultrasonic.h>
+
+//-------------[ INITIALIZATION ]-------------
+// The stages a single ping goes through
+enum PingState {
+  PING_IDLE,          // Not part of the slot in flight
+  PING_PENDING,       // Slot started, waiting for this sensor's turn to trigger
+  PING_WAIT_ECHO,     // Trigger sent, waiting for the echo line to rise
+  PING_ECHO_HIGH,     // Echo line is high, waiting for it to fall
+  PING_COMPLETE       // Echo timed (or timed out), duration is valid
+};
+
+// Everything the engine needs to know about one sensor
+struct UltrasonicChannel {
+  volatile uint8_t *echoRegister;       // Input register of the echo pin's port
+  uint8_t echoMask;                     // Bit of the echo pin in that register
+  uint8_t slotRank;                     // Position in its slot's trigger order
+  volatile PingState state;
+  volatile unsigned long echoStart;     // micros() at the rising edge
+  volatile unsigned long echoDuration;  // Echo pulse width in microseconds
+  unsigned long pingTime;               // micros() when the trigger was sent
+  unsigned long echoDeadline;           // Time after the trigger to give up, in microseconds
+  float lastReading;                    // Previous cycle's distance, NAN before the first
+};
+
+// Indexed by SensorType
+static UltrasonicChannel ultrasonicChannels[NUM_ULTRASONIC_SENSORS];
+
+// Last published distance for each sensor, in cm
+static float ultrasonicDistances[NUM_ULTRASONIC_SENSORS];
+
+// Ranging cycle bookkeeping
+static unsigned long rangingCycleTime = 0;
+static unsigned long slotStartTime = 0; // micros() when the slot in flight started
+static int activeSlot = -1; // Slot currently pinging, -1 when the cycle is done
+static bool reverseOrder = false; // Trigger order of this cycle
+
+//-------------[ PING SLOTS ]-------------
+/**
+ * @brief  Converts a maximum range to the time to wait for its echo.
+ *
+ * @param   maxRangeCm The farthest distance worth measuring.
+ *
+ * @return  Microseconds from the trigger until an echo from that far has ended.
+ */
+constexpr unsigned long echoDeadline(float maxRangeCm) {
+  return ULTRASONIC_ECHO_DELAY_US + (unsigned long)(maxRangeCm * 2 / SPEED_OF_SOUND);
+}
+
+/**
+ * @brief  Finds the longest echo deadline of the sensors in a ping slot.
+ */
+constexpr unsigned long slotDeadline(int slot, int sensor = 0, unsigned long deadline = 0) {
+  return sensor == NUM_ULTRASONIC_SENSORS ? deadline
+       : slotDeadline(slot, sensor + 1,
+                      ULTRASONIC_SENSORS[sensor].pingSlot == slot
+                          && echoDeadline(ULTRASONIC_SENSORS[sensor].maxRangeCm) > deadline
+                          ? echoDeadline(ULTRASONIC_SENSORS[sensor].maxRangeCm) : deadline);
+}
+
+/**
+ * @brief  Counts the ping slots used in ULTRASONIC_SENSORS.
+ */
+constexpr int countPingSlots(int sensor = 0, int slots = 0) {
+  return sensor == NUM_ULTRASONIC_SENSORS ? slots
+       : countPingSlots(sensor + 1, ULTRASONIC_SENSORS[sensor].pingSlot >= slots
+                                        ? ULTRASONIC_SENSORS[sensor].pingSlot + 1 : slots);
+}
+
+/**
+ * @brief  Counts the sensors that share a ping slot.
+ */
+constexpr int countSlotSensors(int slot, int sensor = 0) {
+  return sensor == NUM_ULTRASONIC_SENSORS ? 0
+       : (ULTRASONIC_SENSORS[sensor].pingSlot == slot) + countSlotSensors(slot, sensor + 1);
+}
+
+/**
+ * @brief  Returns the longest a ranging cycle can take, in microseconds.
+ */
+constexpr unsigned long worstCycleTime(int slot = 0) {
+  return slot == countPingSlots() ? 0
+       : (countSlotSensors(slot) - 1) * ULTRASONIC_STAGGER_US + slotDeadline(slot)
+         + ULTRASONIC_SLOT_GUARD_US + worstCycleTime(slot + 1);
+}
+
+constexpr int NUM_PING_SLOTS = countPingSlots();
+static_assert(worstCycleTime() <= SAMPLING_INTERVAL_MS * 1000UL,
+              "Ultrasonic ping slots do not fit in SAMPLING_INTERVAL_MS, share slots between more sensors");
+static_assert(ULTRASONIC_SENSORS[APPROACH_SENSOR].maxRangeCm > APPROACH_EXIT_CM
+              && ULTRASONIC_SENSORS[INTERACTION_SENSOR].maxRangeCm > INTERACTION_EXIT_CM,
+              "A sensor's maximum range must reach past its exit threshold");
+
+// Number of sensors in each slot
+static uint8_t slotSizes[NUM_PING_SLOTS];
+
+//-------------[ FUNCTION PROTOTYPES ]-------------
+static void startPingSlot(int slot, unsigned long delayUs);
+static bool updatePingSlot();
+static void publishUltrasonicReading(int sensor);
+static void startUltrasonicPing(int sensor);
+static bool isUltrasonicPingComplete(int sensor);
+static void handleEchoEdge();
+
+//-------------[ PUBLIC FUNCTIONS ]-------------
+/**
+ * @brief  Configures the sensor pins and enables the echo interrupts.
+ */
+void initializeUltrasonicSensors() {
+
+  for (int i = 0; i < NUM_ULTRASONIC_SENSORS; i++) {
+    const UltrasonicSensor &sensor = ULTRASONIC_SENSORS[i];
+    UltrasonicChannel &channel = ultrasonicChannels[i];
+
+    pinMode(sensor.triggerPin, OUTPUT);
+    pinMode(sensor.echoPin, INPUT);
+    digitalWrite(sensor.triggerPin, LOW);
+
+    // Cache the port register and bit so the ISR avoids digitalRead()
+    channel.echoRegister = portInputRegister(digitalPinToPort(sensor.echoPin));
+    channel.echoMask = digitalPinToBitMask(sensor.echoPin);
+    channel.state = PING_IDLE;
+    channel.lastReading = NAN;
+    channel.echoDeadline = echoDeadline(sensor.maxRangeCm);
+    channel.slotRank = slotSizes[sensor.pingSlot]++;
+
+    // Enable the pin-change interrupt for the echo pin
+    *digitalPinToPCMSK(sensor.echoPin) |= bit(digitalPinToPCMSKbit(sensor.echoPin));
+    *digitalPinToPCICR(sensor.echoPin) |= bit(digitalPinToPCICRbit(sensor.echoPin));
+  }
+}
+
+/**
+ * @brief  Advances the ranging cycle without blocking.
+ *
+ * @details Starts a new cycle every SAMPLING_INTERVAL_MS and runs the ping
+ * slots one at a time. Call this every loop() pass, the staggered triggers
+ * are only as punctual as the calls.
+ *
+ * @return  True on the single call where a fresh set of distances is published.
+ */
+bool updateUltrasonicRanging() {
+
+  if (activeSlot < 0) {
+    if (millis() - rangingCycleTime < SAMPLING_INTERVAL_MS) {
+      return false; // Not time to sample yet
+    }
+    rangingCycleTime = millis(); // Update the timer
+
+    reverseOrder = !reverseOrder;
+    activeSlot = 0;
+    startPingSlot(activeSlot, 0);
+    return false;
+  }
+
+  if (!updatePingSlot()) {
+    return false;
+  }
+
+  // Publish the slot's results and move on to the next slot
+  for (int i = 0; i < NUM_ULTRASONIC_SENSORS; i++) {
+    if (ULTRASONIC_SENSORS[i].pingSlot == activeSlot) {
+      publishUltrasonicReading(i);
+    }
+  }
+
+  activeSlot++;
+  if (activeSlot < NUM_PING_SLOTS) {
+    startPingSlot(activeSlot, ULTRASONIC_SLOT_GUARD_US);
+    return false;
+  }
+
+  activeSlot = -1;
+  return true;
+}
+
+/**
+ * @brief  Returns the last published distance for a sensor.
+ *
+ * @param   sensor The sensor type to read from.
+ *
+ * @return  Distance in centimeters as a float, ULTRASONIC_OUT_OF_RANGE_CM
+ *          if nothing answered from within the sensor's maximum range.
+ */
+float getUltrasonicDistance(SensorType sensor) {
+  return ultrasonicDistances[sensor];
+}
+
+//-------------[ HELPER FUNCTIONS ]-------------
+/**
+ * @brief  Queues every sensor of a slot for its staggered trigger.
+ *
+ * @param   slot The ping slot to start.
+ * @param   delayUs Time to wait before the first trigger.
+ */
+static void startPingSlot(int slot, unsigned long delayUs) {
+  for (int i = 0; i < NUM_ULTRASONIC_SENSORS; i++) {
+    if (ULTRASONIC_SENSORS[i].pingSlot == slot) {
+      ultrasonicChannels[i].state = PING_PENDING;
+    }
+  }
+  slotStartTime = micros() + delayUs;
+}
+
+/**
+ * @brief  Triggers the slot's sensors as their turn comes and checks for completion.
+ *
+ * @return  True once every sensor of the slot has a valid echo duration.
+ */
+static bool updatePingSlot() {
+  long elapsed = (long)(micros() - slotStartTime);
+  if (elapsed < 0) {
+    return false; // Echoes of the previous slot are still fading
+  }
+  bool complete = true;
+
+  for (int i = 0; i < NUM_ULTRASONIC_SENSORS; i++) {
+    if (ULTRASONIC_SENSORS[i].pingSlot != activeSlot) {
+      continue;
+    }
+    UltrasonicChannel &channel = ultrasonicChannels[i];
+
+    if (channel.state == PING_PENDING) {
+      uint8_t turn = reverseOrder ? slotSizes[activeSlot] - 1 - channel.slotRank : channel.slotRank;
+      if ((unsigned long)elapsed >= turn * ULTRASONIC_STAGGER_US) {
+        startUltrasonicPing(i);
+      }
+      complete = false;
+    } else if (!isUltrasonicPingComplete(i)) {
+      complete = false;
+    }
+  }
+
+  return complete;
+}
+
+/**
+ * @brief  Converts a finished ping to a distance and publishes it, rejecting crosstalk.
+ *
+ * @details A reading is suspect if another sensor of the slot was triggered
+ * while its echo was still out, or shortly before its own trigger, within
+ * the other sensor's echo deadline. Either burst may have ended the echo
+ * early. A suspect reading is only published once it agrees with the
+ * sensor's previous reading to within ULTRASONIC_CROSSTALK_TOLERANCE_CM.
+ * Until then the longer of the two is published, as crosstalk can only ever
+ * shorten a reading.
+ *
+ * @param   sensor Index of the sensor.
+ */
+static void publishUltrasonicReading(int sensor) {
+  UltrasonicChannel &channel = ultrasonicChannels[sensor];
+
+  noInterrupts();
+  unsigned long duration = channel.echoDuration;
+  unsigned long echoEnd = channel.echoStart + duration - channel.pingTime;
+  interrupts();
+  channel.state = PING_IDLE;
+
+  bool suspect = false;
+  for (int i = 0; i < NUM_ULTRASONIC_SENSORS && duration > 0; i++) {
+    const UltrasonicChannel &other = ultrasonicChannels[i];
+    unsigned long triggeredAfter = other.pingTime - channel.pingTime;
+    unsigned long triggeredBefore = channel.pingTime - other.pingTime;
+    suspect |= i != sensor && ULTRASONIC_SENSORS[i].pingSlot == activeSlot
+               && (triggeredAfter < echoEnd || triggeredBefore < other.echoDeadline);
+  }
+
+  float distance = (duration * SPEED_OF_SOUND) / 2; // Convert to cm
+  if (duration == 0 || distance > ULTRASONIC_SENSORS[sensor].maxRangeCm) {
+    distance = ULTRASONIC_OUT_OF_RANGE_CM;
+  }
+  if (!suspect || isnan(channel.lastReading)
+      || fabs(distance - channel.lastReading) <= ULTRASONIC_CROSSTALK_TOLERANCE_CM) {
+    ultrasonicDistances[sensor] = distance;
+  } else {
+    ultrasonicDistances[sensor] = max(distance, channel.lastReading);
+  }
+  channel.lastReading = distance;
+}
+
+/**
+ * @brief  Sends the trigger pulse for a sensor and arms its echo capture.
+ *
+ * @param   sensor Index of the sensor to ping.
+ */
+static void startUltrasonicPing(int sensor) {
+  UltrasonicChannel &channel = ultrasonicChannels[sensor];
+  uint8_t triggerPin = ULTRASONIC_SENSORS[sensor].triggerPin;
+
+  // Clear the trigger pin
+  digitalWrite(triggerPin, LOW);
+  delayMicroseconds(ULTRASONIC_CLEAR_PULSE);
+
+  // Set the trigger pin high for a specified pulse duration
+  digitalWrite(triggerPin, HIGH);
+  delayMicroseconds(ULTRASONIC_TRIGGER_PULSE);
+  digitalWrite(triggerPin, LOW);
+
+  channel.pingTime = micros();
+  channel.state = PING_WAIT_ECHO;
+}
+
+/**
+ * @brief  Checks whether a ping has finished, applying the echo timeout.
+ *
+ * @details A ping that has not seen a falling edge by its echo deadline
+ * reports a duration of 0. The sensor may still hold its echo line high for
+ * a while, the ISR ignores it until the next trigger.
+ *
+ * @param   sensor Index of the sensor to check.
+ *
+ * @return  True once the echo duration is valid.
+ */
+static bool isUltrasonicPingComplete(int sensor) {
+  UltrasonicChannel &channel = ultrasonicChannels[sensor];
+
+  if (channel.state == PING_COMPLETE) {
+    return true;
+  }
+
+  if (micros() - channel.pingTime >= channel.echoDeadline) {
+    noInterrupts();
+    // The ISR may have completed the ping since the check above
+    if (channel.state != PING_COMPLETE) {
+      channel.echoDuration = 0;
+      channel.state = PING_COMPLETE;
+    }
+    interrupts();
+    return true;
+  }
+
+  return false;
+}
+
+/**
+ * @brief  Timestamps echo edges for every armed sensor.
+ *
+ * @details Runs in interrupt context. Several sensors can share a pin-change
+ * vector, so each armed channel compares its own pin level to its state.
+ */
+static void handleEchoEdge() {
+  unsigned long now = micros();
+
+  for (int i = 0; i < NUM_ULTRASONIC_SENSORS; i++) {
+    UltrasonicChannel &channel = ultrasonicChannels[i];
+    bool echoHigh = (*channel.echoRegister & channel.echoMask) != 0;
+
+    if (channel.state == PING_WAIT_ECHO && echoHigh) {
+      channel.echoStart = now;
+      channel.state = PING_ECHO_HIGH;
+    } else if (channel.state == PING_ECHO_HIGH && !echoHigh) {
+      channel.echoDuration = now - channel.echoStart;
+      channel.state = PING_COMPLETE;
+    }
+  }
+}
+
+//-------------[ INTERRUPT VECTORS ]-------------
+// The echo pins may sit on any port, so all pin-change vectors are routed
+// to the same handler
+ISR(PCINT0_vect) { handleEchoEdge(); }
+ISR(PCINT1_vect) { handleEchoEdge(); }
+ISR(PCINT2_vect) { handleEchoEdge(); }
@@ -0,0 +1,69 @@
+/**
+ * @file        test_main.cpp
+ * @author      Simon Håkansson
+ * @date        2025-10-08
+ * @brief       Native test of the distance filter's outlier gate.
+ *
+ * @details     Feeds readings in mm straight into filterDistance(). A jump
+ * is only believed once DISTANCE_STEP_CONFIRMATIONS readings in a row agree
+ * on where it went; stray readings that disagree with each other never
+ * reach the output.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+//-------------[ LIBRARIES ]-------------
+#include <unity.h>
+#include <config.h>
+#include <distance_filter.h>
+
+//-------------[ INITIALIZATION ]-------------
+// Distance the filters settle at before each test
+const uint16_t RESTING_DISTANCE_MM = 500;
+
+// Enough readings for the median and the average to settle on a new distance
+const uint8_t SETTLE_READINGS = 20;
+
+//-------------[ TESTS ]-------------
+void setUp() {}
+
+void tearDown() {}
+
+/**
+ * @brief  Out-of-step readings that disagree with each other are all dropped.
+ */
+void test_disagreeing_jumps_are_rejected() {
+  const uint16_t strays[] = {1500, 2500};
+  uint16_t distance = 0;
+
+  for (uint8_t i = 0; i < SETTLE_READINGS; i++) {
+    distance = filterDistance(APPROACH_SENSOR, strays[i % 2]);
+  }
+  TEST_ASSERT_EQUAL_UINT16(RESTING_DISTANCE_MM, distance);
+}
+
+/**
+ * @brief  A jump confirmed by readings close to each other is followed.
+ */
+void test_confirmed_jump_is_accepted() {
+  const uint16_t readings[] = {2000, 2100, 1950, 2050};
+  uint16_t distance = 0;
+
+  for (uint8_t i = 0; i < SETTLE_READINGS; i++) {
+    distance = filterDistance(INTERACTION_SENSOR, readings[i % 4]);
+  }
+  TEST_ASSERT_UINT_WITHIN(DISTANCE_MAX_STEP_MM, 2000, distance);
+}
+
+//-------------[ MAIN FUNCTION ]-------------
+int main() {
+  filterDistance(APPROACH_SENSOR, RESTING_DISTANCE_MM);
+  filterDistance(INTERACTION_SENSOR, RESTING_DISTANCE_MM);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_disagreeing_jumps_are_rejected);
+  RUN_TEST(test_confirmed_jump_is_accepted);
+  return UNITY_END();
+}
@@ -0,0 +1,291 @@
+/**
+ * @file        test_main.cpp
+ * @author      Simon Håkansson
+ * @date        2025-10-08
+ * @brief       Native test of the host link: baud negotiation and binary frames.
+ *
+ * @details     The test plays the host the way serial_protocol.py does,
+ * through the simulated serial port, while setup() and loop() run the real
+ * firmware. The simulated UART has no line rate, so a rate that does not
+ * work is modelled the way the firmware sees it: a missing confirmation or
+ * garbled frames.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+//-------------[ LIBRARIES ]-------------
+#include <unity.h>
+#include <string>
+#include <hal.h>
+#include <config.h>
+#include <host_protocol.h>
+#include <link_speed.h>
+
+//-------------[ INITIALIZATION ]-------------
+// Simulated time between loop() passes, as in the native build
+const unsigned long LOOP_STEP_US = 100;
+
+// Everything the firmware sent since the last takeOutput()
+static std::string hostOutput;
+
+//-------------[ FUNCTION PROTOTYPES ]-------------
+void setup();
+void loop();
+static void runFor(unsigned long durationMs);
+static void sendLine(const char *line);
+static void sendFrame(uint8_t opcode, const uint8_t *payload, uint8_t length);
+static std::string takeOutput();
+static std::string decodeFrame(const std::string &encoded);
+
+//-------------[ TESTS ]-------------
+void setUp() {
+  takeOutput();
+}
+
+/**
+ * @brief  Returns the link to text at BAUD_RATE for the next test.
+ */
+void tearDown() {
+  if (isBinaryProtocol()) {
+    sendFrame(OPCODE_TEXT_MODE, nullptr, 0);
+    runFor(10);
+  }
+  sendLine("baud:reset");
+  runFor(10);
+}
+
+/**
+ * @brief  A proposed rate is acknowledged and kept once confirmed.
+ */
+void test_negotiated_rate_is_confirmed() {
+  sendLine("baud:1000000");
+  runFor(10);
+  TEST_ASSERT_EQUAL_STRING("baud:ack:1000000\n", takeOutput().c_str());
+  TEST_ASSERT_EQUAL_UINT32(1000000, Serial.baudRate());
+
+  sendLine("baud:confirm");
+  runFor(10);
+  TEST_ASSERT_EQUAL_STRING("baud:ok\n", takeOutput().c_str());
+
+  // Still in place well after the confirmation window
+  runFor(2 * BAUD_CONFIRM_TIMEOUT_MS);
+  TEST_ASSERT_EQUAL_UINT32(1000000, getLinkBaudRate());
+}
+
+/**
+ * @brief  Rates with divisor error on the 16 MHz clock are refused.
+ */
+void test_inexact_rate_is_refused() {
+  sendLine("baud:115200");
+  runFor(10);
+  TEST_ASSERT_EQUAL_STRING("baud:nak\n", takeOutput().c_str());
+  TEST_ASSERT_EQUAL_UINT32(BAUD_RATE, Serial.baudRate());
+}
+
+/**
+ * @brief  A host that never confirms gets the link back at BAUD_RATE.
+ */
+void test_unconfirmed_rate_reverts() {
+  sendLine("baud:500000");
+  runFor(BAUD_CONFIRM_TIMEOUT_MS - 50);
+  TEST_ASSERT_EQUAL_UINT32(500000, Serial.baudRate());
+
+  runFor(100);
+  TEST_ASSERT_EQUAL_UINT32(BAUD_RATE, Serial.baudRate());
+}
+
+/**
+ * @brief  Binary frames round trip, with the CRC checked both ways.
+ */
+void test_binary_frames() {
+  sendLine("protocol:binary");
+  runFor(10);
+  TEST_ASSERT_EQUAL_STRING("protocol:binary\n", takeOutput().c_str());
+  TEST_ASSERT_TRUE(isBinaryProtocol());
+
+  uint8_t state = REACTING_NEGATIVE;
+  sendFrame(OPCODE_SET_STATE, &state, 1);
+  runFor(10);
+
+  std::string output = takeOutput();
+  TEST_ASSERT_EQUAL(0, output.back());
+  std::string frame = decodeFrame(output.substr(0, output.size() - 1));
+  TEST_ASSERT_EQUAL_UINT(3, frame.size());
+  TEST_ASSERT_EQUAL_HEX8(OPCODE_MOVEMENT_STATE, (uint8_t)frame[0]);
+  TEST_ASSERT_EQUAL_UINT8(REACTING_NEGATIVE, (uint8_t)frame[1]);
+  TEST_ASSERT_EQUAL_HEX8(crc8((const uint8_t *)frame.data(), 2), (uint8_t)frame[2]);
+}
+
+/**
+ * @brief  Garbled frames at a fast rate make the firmware fall back.
+ */
+void test_link_errors_fall_back() {
+  sendLine("baud:250000");
+  sendLine("baud:confirm");
+  sendLine("protocol:binary");
+  runFor(10);
+  takeOutput();
+
+  // Frames whose CRC does not match, as a marginal rate produces them
+  const char garbled[] = {0x03, 0x01, 0x7F, 0x00};
+  for (uint8_t i = 0; i + 1 < LINK_ERROR_LIMIT; i++) {
+    simSerialInput(garbled, sizeof(garbled));
+  }
+  runFor(10);
+  TEST_ASSERT_EQUAL_UINT32(250000, Serial.baudRate());
+
+  simSerialInput(garbled, sizeof(garbled));
+  runFor(10);
+  std::string output = takeOutput();
+  std::string frame = decodeFrame(output.substr(0, output.size() - 1));
+  TEST_ASSERT_EQUAL_UINT(2, frame.size());
+  TEST_ASSERT_EQUAL_HEX8(OPCODE_LINK_FALLBACK, (uint8_t)frame[0]);
+  TEST_ASSERT_EQUAL_UINT32(BAUD_RATE, Serial.baudRate());
+  TEST_ASSERT_FALSE(isBinaryProtocol());
+}
+
+/**
+ * @brief  Distance telemetry carries the raw readings, not the filtered ones.
+ *
+ * @details A target appearing from out of range is held back by the
+ * filter's rate gate for the first readings, but is streamed at once.
+ */
+void test_distance_telemetry_is_raw() {
+  sendLine("protocol:binary");
+  uint8_t mask = TELEMETRY_DISTANCES;
+  sendFrame(OPCODE_SET_TELEMETRY, &mask, 1);
+  runFor(2 * SAMPLING_INTERVAL_MS);
+  takeOutput();
+
+  simSetUltrasonicDistance(APPROACH_ECHO_PIN, 40);
+  runFor(2 * SAMPLING_INTERVAL_MS);
+  simSetUltrasonicDistance(APPROACH_ECHO_PIN, 0);
+
+  uint16_t approachMm = 0xFFFF;
+  std::string output = takeOutput();
+  for (size_t start = 0, end; (end = output.find('\0', start)) != std::string::npos; start = end + 1) {
+    std::string frame = decodeFrame(output.substr(start, end - start));
+    if (frame.size() == 6 && (uint8_t)frame[0] == OPCODE_DISTANCES && approachMm == 0xFFFF) {
+      approachMm = (uint8_t)frame[1] | (uint8_t)frame[2] << 8;
+    }
+  }
+  TEST_ASSERT_UINT_WITHIN(10, 400, approachMm);
+
+  mask = 0;
+  sendFrame(OPCODE_SET_TELEMETRY, &mask, 1);
+  runFor(10);
+}
+
+/**
+ * @brief  Uploads for states or waveforms that do not exist are rejected.
+ */
+void test_out_of_range_upload_is_rejected() {
+  const char *uploads[] = {
+    "movement:1e10,25,90,1,0", "movement:65535,25,90,1,0", "movement:-1,25,90,1,0",
+    "movement:0,25,90,1,1e10", "movement:0,25,90,1,-1",
+  };
+
+  for (const char *upload : uploads) {
+    sendLine(upload);
+    runFor(10);
+    TEST_ASSERT_EQUAL_STRING_MESSAGE("movement:rejected\n", takeOutput().c_str(), upload);
+  }
+
+  sendLine("movement:0,25,90,1,0");
+  runFor(10);
+  TEST_ASSERT_EQUAL_STRING("movement:staged\n", takeOutput().c_str());
+}
+
+//-------------[ MAIN FUNCTION ]-------------
+int main() {
+  simReset();
+  simAttachUltrasonic(APPROACH_TRIG_PIN, APPROACH_ECHO_PIN);
+  simAttachUltrasonic(INTERACTION_TRIG_PIN, INTERACTION_ECHO_PIN);
+  simSetSerialOutput([](uint8_t c) { hostOutput += (char)c; });
+  setup();
+
+  // Let the startup ramp finish so its ready event is out of the way
+  runFor(1000);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_negotiated_rate_is_confirmed);
+  RUN_TEST(test_inexact_rate_is_refused);
+  RUN_TEST(test_unconfirmed_rate_reverts);
+  RUN_TEST(test_binary_frames);
+  RUN_TEST(test_link_errors_fall_back);
+  RUN_TEST(test_distance_telemetry_is_raw);
+  RUN_TEST(test_out_of_range_upload_is_rejected);
+  return UNITY_END();
+}
+
+//-------------[ HELPER FUNCTIONS ]-------------
+/**
+ * @brief  Runs loop() for a stretch of simulated time.
+ */
+static void runFor(unsigned long durationMs) {
+  uint64_t end = simMicros() + durationMs * 1000ULL;
+  while (simMicros() < end) {
+    loop();
+    simAdvanceMicros(LOOP_STEP_US);
+  }
+}
+
+/**
+ * @brief  Sends a text command as the host would.
+ */
+static void sendLine(const char *line) {
+  simSerialInput(line, strlen(line));
+  simSerialInput("\n", 1);
+}
+
+/**
+ * @brief  Sends a binary frame as the host would, COBS-encoded with its CRC.
+ */
+static void sendFrame(uint8_t opcode, const uint8_t *payload, uint8_t length) {
+  std::string frame(1, (char)opcode);
+  frame.append((const char *)payload, length);
+  frame += (char)crc8((const uint8_t *)frame.data(), frame.size());
+
+  std::string encoded;
+  size_t blockStart = 0;
+  for (size_t i = 0; i <= frame.size(); i++) {
+    if (i == frame.size() || frame[i] == 0) {
+      encoded += (char)(i - blockStart + 1);
+      encoded.append(frame, blockStart, i - blockStart);
+      blockStart = i + 1;
+    }
+  }
+  encoded += '\0';
+  simSerialInput(encoded.data(), encoded.size());
+}
+
+/**
+ * @brief  Returns and clears the output collected from the firmware.
+ */
+static std::string takeOutput() {
+  std::string output;
+  output.swap(hostOutput);
+  return output;
+}
+
+/**
+ * @brief  Decodes one COBS frame without its delimiter, empty if invalid.
+ */
+static std::string decodeFrame(const std::string &encoded) {
+  std::string decoded;
+  size_t index = 0;
+  while (index < encoded.size()) {
+    uint8_t code = encoded[index];
+    if (code == 0 || index + code > encoded.size()) {
+      return std::string();
+    }
+    decoded.append(encoded, index + 1, code - 1);
+    index += code;
+    if (code < 0xFF && index < encoded.size()) {
+      decoded += '\0';
+    }
+  }
+  return decoded;
+}
@@ -0,0 +1,97 @@
+/**
+ * @file        test_main.cpp
+ * @author      Simon Håkansson
+ * @date        2025-10-08
+ * @brief       Native test of the worst-case loop() latency.
+ *
+ * @details     Runs the firmware against the simulated hardware and times
+ * every loop() pass in simulated time, which only moves for delays and I2C
+ * transfers. With pulseIn() a sensor without an echo held loop() for up to
+ * a second; the ranging engine must keep every pass, frames included, well
+ * under a millisecond whether the sensors answer or not.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+//-------------[ LIBRARIES ]-------------
+#include <unity.h>
+#include <hal.h>
+#include <config.h>
+#include <ultrasonic.h>
+
+//-------------[ INITIALIZATION ]-------------
+// Simulated time between loop() passes, as in the native build
+const unsigned long LOOP_STEP_US = 100;
+
+// Longest a loop() pass may take
+const unsigned long LOOP_LATENCY_LIMIT_US = 1000;
+
+//-------------[ FUNCTION PROTOTYPES ]-------------
+void setup();
+void loop();
+static unsigned long runLoop(unsigned long durationMs);
+
+//-------------[ TESTS ]-------------
+void setUp() {}
+
+void tearDown() {}
+
+/**
+ * @brief  Sensors that never answer must not stall the loop.
+ */
+void test_loop_latency_without_echo() {
+  simSetUltrasonicDistance(APPROACH_ECHO_PIN, 0);
+  simSetUltrasonicDistance(INTERACTION_ECHO_PIN, 0);
+
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(LOOP_LATENCY_LIMIT_US, runLoop(3000));
+  TEST_ASSERT_TRUE(getUltrasonicDistance(APPROACH_SENSOR) == ULTRASONIC_OUT_OF_RANGE_CM);
+}
+
+/**
+ * @brief  Echoes are timed in the background while the loop keeps running.
+ */
+void test_loop_latency_with_echo() {
+  simSetUltrasonicDistance(APPROACH_ECHO_PIN, 25);
+  simSetUltrasonicDistance(INTERACTION_ECHO_PIN, 40);
+
+  TEST_ASSERT_LESS_OR_EQUAL_UINT32(LOOP_LATENCY_LIMIT_US, runLoop(3000));
+  TEST_ASSERT_FLOAT_WITHIN(1, 25, getUltrasonicDistance(APPROACH_SENSOR));
+  TEST_ASSERT_FLOAT_WITHIN(1, 40, getUltrasonicDistance(INTERACTION_SENSOR));
+}
+
+//-------------[ MAIN FUNCTION ]-------------
+int main() {
+  simReset();
+  simAttachUltrasonic(APPROACH_TRIG_PIN, APPROACH_ECHO_PIN);
+  simAttachUltrasonic(INTERACTION_TRIG_PIN, INTERACTION_ECHO_PIN);
+  simSetSerialOutput([](uint8_t) {});
+  setup();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_loop_latency_without_echo);
+  RUN_TEST(test_loop_latency_with_echo);
+  return UNITY_END();
+}
+
+//-------------[ HELPER FUNCTIONS ]-------------
+/**
+ * @brief  Runs loop() for a stretch of simulated time.
+ *
+ * @param   durationMs Simulated time to run for.
+ *
+ * @return  The longest loop() pass in microseconds.
+ */
+static unsigned long runLoop(unsigned long durationMs) {
+  uint64_t end = simMicros() + durationMs * 1000ULL;
+  unsigned long slowest = 0;
+
+  while (simMicros() < end) {
+    uint64_t start = simMicros();
+    loop();
+    slowest = max(slowest, (unsigned long)(simMicros() - start));
+    simAdvanceMicros(LOOP_STEP_US);
+  }
+  return slowest;
+}
@@ -0,0 +1,139 @@
+/**
+ * @file        test_main.cpp
+ * @author      Simon Håkansson
+ * @date        2025-10-08
+ * @brief       Native accuracy test of the fixed-point waveform kernel.
+ *
+ * @details     Compares the Q15 tables against sin() and the harmonic sum
+ * they were generated from, across the whole phase range. The cycle cost of
+ * the same lookups is measured by the bench environments, see benchmark.h.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+//-------------[ LIBRARIES ]-------------
+#include <unity.h>
+#include <math.h>
+#include <hal.h>
+#include <config.h>
+#include <motion_kernel.h>
+
+//-------------[ INITIALIZATION ]-------------
+// Phase step of the sweeps. Odd, so every table step and interpolation
+// fraction gets visited.
+const uint32_t PHASE_SWEEP_STEP = 0x00010101;
+
+// Largest error allowed against the exact waveform, in Q15 LSB
+const int SINE_ERROR_LIMIT = 6;
+const int HARMONIC_ERROR_LIMIT = 128; // Linear steps across the 9th and 13th harmonics
+
+//-------------[ FUNCTION PROTOTYPES ]-------------
+static double phaseToRadians(uint32_t phase);
+static int toLsb(double value);
+
+//-------------[ TESTS ]-------------
+void setUp() {}
+
+void tearDown() {}
+
+/**
+ * @brief  The interpolated sine table stays within a few LSB of sin().
+ */
+void test_sine_accuracy() {
+  int worst = 0;
+  uint32_t phase = 0;
+  do {
+    int error = abs(sineQ15(phase) - toLsb(sin(phaseToRadians(phase))));
+    worst = max(worst, error);
+    phase += PHASE_SWEEP_STEP;
+  } while (phase >= PHASE_SWEEP_STEP);
+
+  TEST_ASSERT_LESS_OR_EQUAL_INT(SINE_ERROR_LIMIT, worst);
+}
+
+/**
+ * @brief  The quarter points of the sine are exact.
+ */
+void test_sine_quarter_points() {
+  TEST_ASSERT_EQUAL_INT(0, sineQ15(0));
+  TEST_ASSERT_EQUAL_INT(32767, sineQ15(0x40000000));
+  TEST_ASSERT_EQUAL_INT(0, sineQ15(0x80000000));
+  TEST_ASSERT_EQUAL_INT(-32767, sineQ15(0xC0000000));
+}
+
+/**
+ * @brief  The sine waveform is the sine table.
+ */
+void test_sine_waveform_matches_table() {
+  for (uint32_t phase = 0; phase < 0xFFFF0000; phase += 0x00FF00FF) {
+    TEST_ASSERT_EQUAL_INT(sineQ15(phase), evaluateWaveform(WAVEFORM_SINE, phase));
+  }
+}
+
+/**
+ * @brief  The table built at compile time follows the harmonic sum.
+ */
+void test_shiver_accuracy() {
+  int worst = 0;
+  uint32_t phase = 0;
+  do {
+    double radians = phaseToRadians(phase);
+    double exact = 0;
+    for (const Harmonic &harmonic : SHIVER_HARMONICS) {
+      exact += harmonic.amplitude * sin(harmonic.multiple * radians + harmonic.phase);
+    }
+    worst = max(worst, abs(evaluateWaveform(WAVEFORM_SHIVER, phase) - toLsb(exact)));
+    phase += PHASE_SWEEP_STEP;
+  } while (phase >= PHASE_SWEEP_STEP);
+
+  TEST_ASSERT_LESS_OR_EQUAL_INT(HARMONIC_ERROR_LIMIT, worst);
+}
+
+/**
+ * @brief  Keyframes are hit exactly at their spacing in the cycle.
+ */
+void test_bloom_keyframes() {
+  const int segments = sizeof(BLOOM_KEYFRAMES) / sizeof(BLOOM_KEYFRAMES[0]) - 1;
+  for (int k = 0; k < segments; k++) {
+    uint32_t phase = (uint32_t)((4294967296.0 * k) / segments);
+    TEST_ASSERT_INT_WITHIN(SINE_ERROR_LIMIT, toLsb(BLOOM_KEYFRAMES[k]), evaluateWaveform(WAVEFORM_BLOOM, phase));
+  }
+}
+
+/**
+ * @brief  Radians convert to binary angles with 2^32 per turn.
+ */
+void test_radians_to_phase() {
+  TEST_ASSERT_EQUAL_UINT32(0, radiansToPhase(0));
+  TEST_ASSERT_UINT32_WITHIN(0x100, 0x40000000, radiansToPhase(PI / 2));
+  TEST_ASSERT_UINT32_WITHIN(0x100, 0x80000000, radiansToPhase(PI));
+}
+
+//-------------[ MAIN FUNCTION ]-------------
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_sine_accuracy);
+  RUN_TEST(test_sine_quarter_points);
+  RUN_TEST(test_sine_waveform_matches_table);
+  RUN_TEST(test_shiver_accuracy);
+  RUN_TEST(test_bloom_keyframes);
+  RUN_TEST(test_radians_to_phase);
+  return UNITY_END();
+}
+
+//-------------[ HELPER FUNCTIONS ]-------------
+/**
+ * @brief  Converts a binary angle to radians.
+ */
+static double phaseToRadians(uint32_t phase) {
+  return phase * (2 * PI / 4294967296.0);
+}
+
+/**
+ * @brief  Scales a value in [-1, 1] to Q15 LSB.
+ */
+static int toLsb(double value) {
+  return (int)lround(value * 32767);
+}
@@ -0,0 +1,165 @@
+/**
+ * @file        test_main.cpp
+ * @author      Simon Håkansson
+ * @date        2025-10-08
+ * @brief       Native test of the EEPROM movement store.
+ *
+ * @details     Saves banks through the simulated EEPROM and loads them back,
+ * including records that pass their CRC but hold sets the leaves cannot
+ * follow. The record layout mirrors MovementRecord in movement_store.cpp.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+//-------------[ LIBRARIES ]-------------
+#include <unity.h>
+#include <stddef.h>
+#include <hal.h>
+#include <config.h>
+#include <host_protocol.h>
+#include <movement_store.h>
+
+//-------------[ INITIALIZATION ]-------------
+// One saved bank, as laid out in an EEPROM slot
+struct StoredRecord {
+  MovementSet sets[NUM_MOVEMENT_STATES];
+  uint8_t version;
+  uint8_t sequence;
+  uint8_t crc;
+};
+
+const MovementSet UPLOADED_SET = {10, 100, 2, WAVEFORM_BLOOM};
+
+//-------------[ FUNCTION PROTOTYPES ]-------------
+static void saveActivatedSets();
+static void writeRecord(const MovementSet *sets);
+static bool isSameSet(const MovementSet &a, const MovementSet &b);
+
+//-------------[ TESTS ]-------------
+void setUp() {
+  simReset();
+  simEraseEEPROM();
+  loadMovementSets();
+}
+
+void tearDown() {}
+
+/**
+ * @brief  Every built-in set passes the checks uploads go through.
+ */
+void test_defaults_are_valid() {
+  for (int state = 0; state < NUM_MOVEMENT_STATES; state++) {
+    TEST_ASSERT_TRUE(isValidMovementSet(getMovementSet((MovementState)state)));
+  }
+}
+
+/**
+ * @brief  The defaults can be staged and activated like any upload.
+ */
+void test_defaults_can_be_restaged() {
+  stageDefaultMovementSets();
+  for (int state = 0; state < NUM_MOVEMENT_STATES; state++) {
+    TEST_ASSERT_TRUE(stageMovementSet((MovementState)state, getMovementSet((MovementState)state)));
+  }
+}
+
+/**
+ * @brief  States outside the bank are rejected at either end.
+ */
+void test_out_of_range_state_is_rejected() {
+  TEST_ASSERT_FALSE(stageMovementSet((MovementState)NUM_MOVEMENT_STATES, UPLOADED_SET));
+  TEST_ASSERT_FALSE(stageMovementSet((MovementState)-1, UPLOADED_SET));
+  TEST_ASSERT_FALSE(stageMovementSet((MovementState)INT16_MIN, UPLOADED_SET));
+}
+
+/**
+ * @brief  An activated bank is saved and loaded back after a reset.
+ */
+void test_saved_sets_survive_reset() {
+  TEST_ASSERT_TRUE(stageMovementSet(REACTING_NEGATIVE, UPLOADED_SET));
+  activateMovementSets();
+  saveActivatedSets();
+
+  simReset();
+  loadMovementSets();
+  TEST_ASSERT_TRUE(isSameSet(UPLOADED_SET, getMovementSet(REACTING_NEGATIVE)));
+}
+
+/**
+ * @brief  A complete record with an unknown waveform is not used.
+ */
+void test_invalid_waveform_falls_back() {
+  MovementSet sets[NUM_MOVEMENT_STATES];
+  for (int state = 0; state < NUM_MOVEMENT_STATES; state++) {
+    sets[state] = UPLOADED_SET;
+  }
+  sets[LISTEN].waveform = NUM_WAVEFORMS;
+  writeRecord(sets);
+
+  loadMovementSets();
+  TEST_ASSERT_TRUE(isSameSet(IDLE_MOVEMENT, getMovementSet(IDLE)));
+  TEST_ASSERT_TRUE(isSameSet(LISTEN_MOVEMENT, getMovementSet(LISTEN)));
+}
+
+/**
+ * @brief  A complete record swinging past the leaf limits is not used.
+ */
+void test_out_of_range_set_falls_back() {
+  MovementSet sets[NUM_MOVEMENT_STATES] = {
+    IDLE_MOVEMENT, LISTEN_MOVEMENT, POSITIVE_MOVEMENT, {5, 135, 3, WAVEFORM_SHIVER}, NEUTRAL_MOVEMENT
+  };
+  writeRecord(sets);
+
+  loadMovementSets();
+  TEST_ASSERT_TRUE(isSameSet(NEGATIVE_MOVEMENT, getMovementSet(REACTING_NEGATIVE)));
+}
+
+//-------------[ MAIN FUNCTION ]-------------
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_defaults_are_valid);
+  RUN_TEST(test_defaults_can_be_restaged);
+  RUN_TEST(test_out_of_range_state_is_rejected);
+  RUN_TEST(test_saved_sets_survive_reset);
+  RUN_TEST(test_invalid_waveform_falls_back);
+  RUN_TEST(test_out_of_range_set_falls_back);
+  return UNITY_END();
+}
+
+//-------------[ HELPER FUNCTIONS ]-------------
+/**
+ * @brief  Runs the background save until the EEPROM stops changing.
+ */
+static void saveActivatedSets() {
+  for (int i = 0; i < 100; i++) {
+    updateMovementStore();
+    simAdvanceMicros(5000);
+  }
+}
+
+/**
+ * @brief  Writes a complete record with a matching CRC to the first slot.
+ */
+static void writeRecord(const MovementSet *sets) {
+  StoredRecord record;
+  memset(&record, 0, sizeof(record));
+  memcpy(record.sets, sets, sizeof(record.sets));
+  record.version = MOVEMENT_STORE_VERSION;
+  record.sequence = 1;
+  record.crc = crc8((const uint8_t *)&record, offsetof(StoredRecord, crc));
+
+  const uint8_t *bytes = (const uint8_t *)&record;
+  for (uint8_t i = 0; i <= offsetof(StoredRecord, crc); i++) {
+    EEPROM.write(MOVEMENT_STORE_ADDRESS + i, bytes[i]);
+  }
+}
+
+/**
+ * @brief  Compares two movement sets field by field.
+ */
+static bool isSameSet(const MovementSet &a, const MovementSet &b) {
+  return a.amplitude == b.amplitude && a.centerAngle == b.centerAngle
+      && a.speedFactor == b.speedFactor && a.waveform == b.waveform;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file        test_main.cpp
+ * @author      Simon Håkansson
+ * @date        2025-10-08
+ * @brief       Native test of the movement transition engine.
+ *
+ * @details     Drives the transition engine directly in simulated time and
+ * checks that the blended waveform never jumps when a transition starts,
+ * including one that interrupts a running waveform fade.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+//-------------[ LIBRARIES ]-------------
+#include <unity.h>
+#include <hal.h>
+#include <config.h>
+#include <motion_kernel.h>
+#include <movement_transition.h>
+
+//-------------[ INITIALIZATION ]-------------
+// Phases the waveform is compared at
+const uint32_t SAMPLE_PHASES[] = {0x10000000, 0x50000000, 0x90000000, 0xD0000000};
+
+// Largest change of the blended sample allowed across a transition start, in Q15
+const int SAMPLE_STEP_LIMIT = 1;
+
+const MovementSet SINE_SET = {20, 90, 1, WAVEFORM_SINE};
+const MovementSet SHIVER_SET = {20, 90, 1, WAVEFORM_SHIVER};
+const MovementSet BLOOM_SET = {20, 90, 1, WAVEFORM_BLOOM};
+
+//-------------[ FUNCTION PROTOTYPES ]-------------
+static void advance(unsigned long ms);
+static void assertContinuousStart(const MovementSet &target);
+
+//-------------[ TESTS ]-------------
+void setUp() {
+  setActiveMovement(SINE_SET);
+}
+
+void tearDown() {}
+
+/**
+ * @brief  A new waveform fades in from the old one and ends on the new one.
+ */
+void test_waveform_fades_in() {
+  assertContinuousStart(SHIVER_SET);
+  advance(MOVEMENT_TRANSITION_MS / 2);
+  TEST_ASSERT_EQUAL(WAVEFORM_SHIVER, getActiveMovement().waveform);
+
+  advance(MOVEMENT_TRANSITION_MS);
+  for (uint32_t phase : SAMPLE_PHASES) {
+    TEST_ASSERT_EQUAL_INT(evaluateWaveform(WAVEFORM_SHIVER, phase), sampleActiveWaveform(phase));
+  }
+}
+
+/**
+ * @brief  A third waveform asked for mid-fade waits for the fade to finish.
+ */
+void test_interrupted_fade_is_continuous() {
+  startMovementTransition(SHIVER_SET);
+  advance(MOVEMENT_TRANSITION_MS / 2);
+  assertContinuousStart(BLOOM_SET);
+
+  // The shiver fade completes, then bloom fades in over it
+  advance(MOVEMENT_TRANSITION_MS / 2);
+  TEST_ASSERT_EQUAL(WAVEFORM_BLOOM, getActiveMovement().waveform);
+  advance(MOVEMENT_TRANSITION_MS);
+  for (uint32_t phase : SAMPLE_PHASES) {
+    TEST_ASSERT_EQUAL_INT(evaluateWaveform(WAVEFORM_BLOOM, phase), sampleActiveWaveform(phase));
+  }
+}
+
+/**
+ * @brief  Turning back to the old waveform mid-fade does not jump either.
+ */
+void test_reversed_fade_is_continuous() {
+  startMovementTransition(SHIVER_SET);
+  advance(MOVEMENT_TRANSITION_MS / 3);
+  assertContinuousStart(SINE_SET);
+
+  advance(3 * MOVEMENT_TRANSITION_MS);
+  for (uint32_t phase : SAMPLE_PHASES) {
+    TEST_ASSERT_EQUAL_INT(sineQ15(phase), sampleActiveWaveform(phase));
+  }
+}
+
+/**
+ * @brief  Amplitude, center and speed blend on from where they are.
+ */
+void test_scalars_blend_from_current_values() {
+  const MovementSet wide = {40, 100, 2, WAVEFORM_SINE};
+  startMovementTransition(wide);
+  advance(MOVEMENT_TRANSITION_MS / 2);
+  updateMovementTransition();
+  MovementSet halfway = getActiveMovement();
+
+  startMovementTransition(SINE_SET);
+  updateMovementTransition();
+  TEST_ASSERT_FLOAT_WITHIN(0.01, halfway.amplitude, getActiveMovement().amplitude);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, halfway.centerAngle, getActiveMovement().centerAngle);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, halfway.speedFactor, getActiveMovement().speedFactor);
+
+  advance(MOVEMENT_TRANSITION_MS);
+  TEST_ASSERT_FLOAT_WITHIN(0.01, SINE_SET.amplitude, getActiveMovement().amplitude);
+}
+
+//-------------[ MAIN FUNCTION ]-------------
+int main() {
+  simReset();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_waveform_fades_in);
+  RUN_TEST(test_interrupted_fade_is_continuous);
+  RUN_TEST(test_reversed_fade_is_continuous);
+  RUN_TEST(test_scalars_blend_from_current_values);
+  return UNITY_END();
+}
+
+//-------------[ HELPER FUNCTIONS ]-------------
+/**
+ * @brief  Moves simulated time on in motion frames, updating the transition.
+ */
+static void advance(unsigned long ms) {
+  for (unsigned long t = 0; t < ms; t += 1000 / MOTION_FRAME_RATE_HZ) {
+    simAdvanceMicros(1000000UL / MOTION_FRAME_RATE_HZ);
+    updateMovementTransition();
+  }
+}
+
+/**
+ * @brief  Starts a transition and checks the blended waveform did not move.
+ */
+static void assertContinuousStart(const MovementSet &target) {
+  int16_t before[sizeof(SAMPLE_PHASES) / sizeof(SAMPLE_PHASES[0])];
+  for (uint8_t i = 0; i < sizeof(SAMPLE_PHASES) / sizeof(SAMPLE_PHASES[0]); i++) {
+    before[i] = sampleActiveWaveform(SAMPLE_PHASES[i]);
+  }
+
+  startMovementTransition(target);
+  updateMovementTransition();
+
+  for (uint8_t i = 0; i < sizeof(SAMPLE_PHASES) / sizeof(SAMPLE_PHASES[0]); i++) {
+    TEST_ASSERT_INT_WITHIN(SAMPLE_STEP_LIMIT, before[i], sampleActiveWaveform(SAMPLE_PHASES[i]));
+  }
+}
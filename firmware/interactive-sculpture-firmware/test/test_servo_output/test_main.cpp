@@ -0,0 +1,144 @@
+/**
+ * @file        test_main.cpp
+ * @author      Simon Håkansson
+ * @date        2025-10-08
+ * @brief       Native test of the batched PCA9685 output stage.
+ *
+ * @details     Counts the bytes and transmissions on the simulated I2C bus.
+ * A full frame goes out in auto-increment bursts of at most
+ * CHANNELS_PER_BURST neighbouring channels, an unchanged frame puts nothing
+ * on the bus, and a burst the board does not acknowledge is sent again
+ * with the next frame.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+//-------------[ LIBRARIES ]-------------
+#include <unity.h>
+#include <hal.h>
+#include <config.h>
+#include <leaf_config.h>
+#include <servo_output.h>
+
+//-------------[ INITIALIZATION ]-------------
+// Channels that fit in one Wire transmission, as in servo_output.cpp
+const uint8_t CHANNELS_PER_BURST = (BUFFER_LENGTH - 1) / 4;
+
+// Pulse staged for the first leaf, the others follow one tick apart
+static uint16_t frameBaseTicks = 300;
+
+//-------------[ FUNCTION PROTOTYPES ]-------------
+static void stageFrame(uint16_t baseTicks);
+static uint8_t countBursts();
+static void assertFrameOnBoards(uint16_t baseTicks);
+
+//-------------[ TESTS ]-------------
+void setUp() {}
+
+void tearDown() {}
+
+/**
+ * @brief  A frame with every leaf changed goes out in full bursts.
+ *
+ * @details Each burst is the address, the first register and four bytes
+ * per channel.
+ */
+void test_full_frame_is_burst() {
+  unsigned long bytes = simWireBytes();
+  unsigned long transactions = simWireTransactions();
+
+  frameBaseTicks += 100;
+  stageFrame(frameBaseTicks);
+  flushServoFrame();
+
+  uint8_t bursts = countBursts();
+  TEST_ASSERT_EQUAL_UINT32(bursts, simWireTransactions() - transactions);
+  TEST_ASSERT_EQUAL_UINT32(2 * bursts + 4 * NUM_LEAVES, simWireBytes() - bytes);
+  assertFrameOnBoards(frameBaseTicks);
+}
+
+/**
+ * @brief  A frame without changes is left off the bus and counted as skipped.
+ */
+void test_unchanged_frame_is_skipped() {
+  stageFrame(frameBaseTicks);
+  flushServoFrame();
+
+  unsigned long bytes = simWireBytes();
+  unsigned long skipped = getSkippedServoWrites();
+  stageFrame(frameBaseTicks);
+  flushServoFrame();
+
+  TEST_ASSERT_EQUAL_UINT32(0, simWireBytes() - bytes);
+  TEST_ASSERT_EQUAL_UINT32(NUM_LEAVES, getSkippedServoWrites() - skipped);
+}
+
+/**
+ * @brief  A burst the board refuses stays pending and is sent again.
+ */
+void test_refused_burst_is_resent() {
+  uint16_t previousTicks = frameBaseTicks;
+  frameBaseTicks += 100;
+  stageFrame(frameBaseTicks);
+
+  simNackWireTransmissions(countBursts());
+  unsigned long skipped = getSkippedServoWrites();
+  flushServoFrame();
+  assertFrameOnBoards(previousTicks);
+
+  unsigned long transactions = simWireTransactions();
+  flushServoFrame();
+  TEST_ASSERT_EQUAL_UINT32(countBursts(), simWireTransactions() - transactions);
+  TEST_ASSERT_EQUAL_UINT32(skipped, getSkippedServoWrites());
+  assertFrameOnBoards(frameBaseTicks);
+}
+
+//-------------[ MAIN FUNCTION ]-------------
+int main() {
+  simReset();
+  initializeServoOutput();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_full_frame_is_burst);
+  RUN_TEST(test_unchanged_frame_is_skipped);
+  RUN_TEST(test_refused_burst_is_resent);
+  return UNITY_END();
+}
+
+//-------------[ HELPER FUNCTIONS ]-------------
+/**
+ * @brief  Stages a different pulse for every leaf.
+ */
+static void stageFrame(uint16_t baseTicks) {
+  for (uint8_t leaf = 0; leaf < NUM_LEAVES; leaf++) {
+    setServoTicks(leaf, baseTicks + leaf);
+  }
+}
+
+/**
+ * @brief  Counts the bursts a frame with every leaf changed takes.
+ */
+static uint8_t countBursts() {
+  uint8_t bursts = 0;
+  uint8_t run = 0;
+
+  for (uint8_t leaf = 0; leaf < NUM_LEAVES; leaf++) {
+    if (run == 0 || run == CHANNELS_PER_BURST || !doesLeafContinueBurst(leaf)) {
+      bursts++;
+      run = 0;
+    }
+    run++;
+  }
+  return bursts;
+}
+
+/**
+ * @brief  Checks that every leaf's channel holds the pulse of a frame.
+ */
+static void assertFrameOnBoards(uint16_t baseTicks) {
+  for (uint8_t leaf = 0; leaf < NUM_LEAVES; leaf++) {
+    TEST_ASSERT_EQUAL_UINT16(baseTicks + leaf, simServoTicks(getLeafBoard(leaf), getLeafChannel(leaf)));
+  }
+}
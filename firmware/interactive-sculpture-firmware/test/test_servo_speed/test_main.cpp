@@ -0,0 +1,147 @@
+/**
+ * @file        test_main.cpp
+ * @author      Simon Håkansson
+ * @date        2025-10-08
+ * @brief       Native test of the peak servo speed during movement changes.
+ *
+ * @details     Watches every PCA9685 channel write on the simulated bus and
+ * converts the change between two writes to degrees per second. However
+ * the movement changes, no leaf may be driven faster than its LEAF_RANGES
+ * maxSpeed, give or take the rounding of one tick per frame.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+//-------------[ LIBRARIES ]-------------
+#include <unity.h>
+#include <hal.h>
+#include <config.h>
+#include <leaf_config.h>
+#include <movement_store.h>
+#include <movement_transition.h>
+#include <servo_calibration.h>
+
+//-------------[ INITIALIZATION ]-------------
+// Simulated time between loop() passes, as in the native build
+const unsigned long LOOP_STEP_US = 100;
+
+// Speed of one tick per frame, the most the pulse rounding can add
+const float TICK_SPEED_TOLERANCE = 256.0 / degreesToTicksQ8(1) * MOTION_FRAME_RATE_HZ;
+
+// Last pulse and write time of every leaf, and the highest ratio of its
+// speed to its limit since the last resetPeakSpeed()
+static uint16_t leafTicks[NUM_LEAVES];
+static uint64_t leafTimes[NUM_LEAVES];
+static float peakSpeedExcess = 0;
+
+//-------------[ FUNCTION PROTOTYPES ]-------------
+void setup();
+void loop();
+void setMovementState(MovementState state);
+void applyActiveMovement();
+static void runFor(unsigned long durationMs);
+static void trackServoSpeed(uint8_t address, uint8_t channel, uint16_t ticks);
+
+//-------------[ TESTS ]-------------
+void setUp() {
+  peakSpeedExcess = 0;
+}
+
+void tearDown() {}
+
+/**
+ * @brief  State changes blend in without exceeding the slew limits.
+ */
+void test_transitions_stay_within_slew_limit() {
+  const MovementState states[] = {REACTING_NEGATIVE, IDLE, REACTING_POSITIVE, LISTEN, REACTING_NEGATIVE, IDLE};
+
+  for (MovementState state : states) {
+    setMovementState(state);
+    runFor(MOVEMENT_TRANSITION_MS + 500);
+  }
+  TEST_ASSERT_LESS_OR_EQUAL(0, peakSpeedExcess);
+}
+
+/**
+ * @brief  State changes in quick succession restart the blend smoothly.
+ */
+void test_interrupted_transitions_stay_within_slew_limit() {
+  const MovementState states[] = {REACTING_NEGATIVE, IDLE, REACTING_POSITIVE, REACTING_NEGATIVE, LISTEN, IDLE};
+
+  for (MovementState state : states) {
+    setMovementState(state);
+    runFor(MOVEMENT_TRANSITION_MS / 3);
+  }
+  runFor(MOVEMENT_TRANSITION_MS);
+  TEST_ASSERT_LESS_OR_EQUAL(0, peakSpeedExcess);
+}
+
+/**
+ * @brief  Even an instant switch of movement set is held to the slew limit.
+ */
+void test_instant_switch_is_slew_limited() {
+  const MovementState states[] = {REACTING_NEGATIVE, IDLE, LISTEN, REACTING_POSITIVE};
+
+  for (MovementState state : states) {
+    setActiveMovement(getMovementSet(state));
+    applyActiveMovement();
+    runFor(1000);
+  }
+  TEST_ASSERT_LESS_OR_EQUAL(0, peakSpeedExcess);
+}
+
+//-------------[ MAIN FUNCTION ]-------------
+int main() {
+  simReset();
+  simAttachUltrasonic(APPROACH_TRIG_PIN, APPROACH_ECHO_PIN);
+  simAttachUltrasonic(INTERACTION_TRIG_PIN, INTERACTION_ECHO_PIN);
+  simSetSerialOutput([](uint8_t) {});
+  simSetServoListener(trackServoSpeed);
+  setup();
+
+  // Leaves jump to their first pulse during the startup ramp, which is
+  // what the ramp is for, so speeds are only checked once it is done
+  runFor(1000);
+
+  UNITY_BEGIN();
+  RUN_TEST(test_transitions_stay_within_slew_limit);
+  RUN_TEST(test_interrupted_transitions_stay_within_slew_limit);
+  RUN_TEST(test_instant_switch_is_slew_limited);
+  return UNITY_END();
+}
+
+//-------------[ HELPER FUNCTIONS ]-------------
+/**
+ * @brief  Runs loop() for a stretch of simulated time.
+ */
+static void runFor(unsigned long durationMs) {
+  uint64_t end = simMicros() + durationMs * 1000ULL;
+  while (simMicros() < end) {
+    loop();
+    simAdvanceMicros(LOOP_STEP_US);
+  }
+}
+
+/**
+ * @brief  Records by how much a leaf's speed between two writes beats its limit.
+ */
+static void trackServoSpeed(uint8_t address, uint8_t channel, uint16_t ticks) {
+  uint64_t now = simMicros();
+
+  for (uint8_t leaf = 0; leaf < NUM_LEAVES; leaf++) {
+    if (getLeafBoard(leaf) != address || getLeafChannel(leaf) != channel) {
+      continue;
+    }
+
+    if (leafTicks[leaf] != 0 && now > leafTimes[leaf]) {
+      float degrees = abs((int)ticks - (int)leafTicks[leaf]) * 256.0 / degreesToTicksQ8(1);
+      float seconds = (now - leafTimes[leaf]) / 1000000.0;
+      float excess = degrees / seconds - LEAF_RANGES[leaf].maxSpeed - TICK_SPEED_TOLERANCE;
+      peakSpeedExcess = max(peakSpeedExcess, excess);
+    }
+    leafTicks[leaf] = ticks;
+    leafTimes[leaf] = now;
+  }
+}
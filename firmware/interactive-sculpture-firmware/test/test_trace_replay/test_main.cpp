@@ -0,0 +1,201 @@
+/**
+ * @file        test_main.cpp
+ * @author      Simon Håkansson
+ * @date        2025-10-08
+ * @brief       Native test of user detection against a replayed trace.
+ *
+ * @details     Replays the traces in test/traces one after the other and
+ * records every serial output line with its time into the trace. A
+ * visitor stepping inside and back outside the approach thresholds must
+ * start and end the approach about USER_EVENT_LATENCY_MS after each
+ * crossing. Swaying across only one threshold, or pulling back for less
+ * than a dwell time, must not raise any extra events. A trace with no rows
+ * must still run out.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+//-------------[ LIBRARIES ]-------------
+#include <stdio.h>
+#include <unity.h>
+#include <hal.h>
+#include <config.h>
+#include <trace_replay.h>
+
+//-------------[ INITIALIZATION ]-------------
+// Simulated time between loop() passes, as in the native build
+const unsigned long LOOP_STEP_US = 100;
+
+// Time to keep running after the last trace row
+const unsigned long TRACE_TAIL_MS = 1000;
+
+// Times of the threshold crossings in approach_and_leave.csv
+const unsigned long APPROACH_CROSSING_MS = 2000;
+const unsigned long LEAVE_CROSSING_MS = 5000;
+
+// Delay the distance filter adds to a clean crossing, give or take one sample
+const unsigned long USER_EVENT_LATENCY_MS = 300;
+
+// Time the visitor in hovering_at_threshold.csv walks away
+const unsigned long HOVERING_LEAVE_MS = 6200;
+
+// A serial output line and the time into the trace it ended
+struct SerialLine {
+  char text[48];
+  unsigned long timeMs;
+};
+
+static SerialLine serialLines[16];
+static uint8_t serialLineCount = 0;
+static size_t serialLineLength = 0;
+static uint64_t traceStartTime = 0;
+
+//-------------[ FUNCTION PROTOTYPES ]-------------
+void setup();
+void loop();
+static unsigned long replayTrace(const char *name);
+static uint8_t countEvents(const char *text, unsigned long *timeMs);
+static void collectSerialLine(uint8_t c);
+
+//-------------[ TESTS ]-------------
+void setUp() {
+  serialLineCount = 0;
+}
+
+void tearDown() {}
+
+/**
+ * @brief  A trace with only a header runs out on the first update.
+ */
+void test_empty_trace_ends() {
+  TEST_ASSERT_EQUAL_UINT(0, replayTrace("empty.csv"));
+  TEST_ASSERT_EQUAL_UINT(0, getTraceRows());
+}
+
+/**
+ * @brief  Crossing the approach thresholds starts and ends one approach.
+ */
+void test_approach_and_leave_events() {
+  unsigned long startMs = 0;
+  unsigned long endMs = 0;
+
+  TEST_ASSERT_EQUAL_UINT(3, replayTrace("approach_and_leave.csv"));
+  TEST_ASSERT_EQUAL_UINT8(1, countEvents("event:user_approach_start", &startMs));
+  TEST_ASSERT_EQUAL_UINT8(1, countEvents("event:user_approach_end", &endMs));
+  TEST_ASSERT_UINT_WITHIN(SAMPLING_INTERVAL_MS, APPROACH_CROSSING_MS + USER_EVENT_LATENCY_MS, startMs);
+  TEST_ASSERT_UINT_WITHIN(SAMPLING_INTERVAL_MS, LEAVE_CROSSING_MS + USER_EVENT_LATENCY_MS, endMs);
+}
+
+/**
+ * @brief  Swaying across the enter threshold only gives one approach.
+ *
+ * @details The visitor sways between 28 and 34 cm, across the approach
+ * enter threshold but inside its exit threshold, before walking away.
+ */
+void test_hovering_visitor_gives_one_approach() {
+  unsigned long startMs = 0;
+  unsigned long endMs = 0;
+
+  replayTrace("hovering_at_threshold.csv");
+  TEST_ASSERT_EQUAL_UINT8(1, countEvents("event:user_approach_start", &startMs));
+  TEST_ASSERT_EQUAL_UINT8(1, countEvents("event:user_approach_end", &endMs));
+  TEST_ASSERT_GREATER_OR_EQUAL(HOVERING_LEAVE_MS, endMs);
+}
+
+/**
+ * @brief  Pulling back for less than the interaction dwell time ends nothing.
+ *
+ * @details The visitor leans in, and pulls back past the interaction exit
+ * threshold half a second later, for less than USER_INTERACTING_DWELL_MS.
+ */
+void test_brief_pull_back_keeps_interaction() {
+  unsigned long timeMs = 0;
+
+  replayTrace("brief_pull_back.csv");
+  TEST_ASSERT_EQUAL_UINT8(1, countEvents("event:user_interaction_start", &timeMs));
+  TEST_ASSERT_EQUAL_UINT8(1, countEvents("event:user_interaction_end", &timeMs));
+}
+
+//-------------[ MAIN FUNCTION ]-------------
+int main() {
+  simReset();
+  simAttachUltrasonic(APPROACH_TRIG_PIN, APPROACH_ECHO_PIN);
+  simAttachUltrasonic(INTERACTION_TRIG_PIN, INTERACTION_ECHO_PIN);
+  simSetSerialOutput(collectSerialLine);
+  setup();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_empty_trace_ends);
+  RUN_TEST(test_approach_and_leave_events);
+  RUN_TEST(test_hovering_visitor_gives_one_approach);
+  RUN_TEST(test_brief_pull_back_keeps_interaction);
+  return UNITY_END();
+}
+
+//-------------[ HELPER FUNCTIONS ]-------------
+/**
+ * @brief  Replays a trace from test/traces, then runs TRACE_TAIL_MS more.
+ *
+ * @details The firmware carries on from the previous trace, which always
+ * ends with the visitor gone.
+ *
+ * @return  The number of trace rows applied.
+ */
+static unsigned long replayTrace(const char *name) {
+  // The traces sit next to the test folders
+  char path[256];
+  const char *slash = strrchr(__FILE__, '/');
+  snprintf(path, sizeof(path), "%.*s../traces/%s", slash ? (int)(slash - __FILE__ + 1) : 0, __FILE__, name);
+  TEST_ASSERT_TRUE_MESSAGE(openTrace(path), path);
+  traceStartTime = simMicros();
+
+  while (updateTrace()) {
+    loop();
+    simAdvanceMicros(LOOP_STEP_US);
+  }
+  uint64_t end = simMicros() + TRACE_TAIL_MS * 1000ULL;
+  while (simMicros() < end) {
+    loop();
+    simAdvanceMicros(LOOP_STEP_US);
+  }
+
+  unsigned long rows = getTraceRows();
+  closeTrace();
+  return rows;
+}
+
+/**
+ * @brief  Counts the serial lines matching an event, with the time of the last.
+ */
+static uint8_t countEvents(const char *text, unsigned long *timeMs) {
+  uint8_t count = 0;
+
+  for (uint8_t i = 0; i < serialLineCount; i++) {
+    if (strcmp(serialLines[i].text, text) == 0) {
+      *timeMs = serialLines[i].timeMs;
+      count++;
+    }
+  }
+  return count;
+}
+
+/**
+ * @brief  Collects serial output into lines stamped with their time into the trace.
+ */
+static void collectSerialLine(uint8_t c) {
+  if (serialLineCount == sizeof(serialLines) / sizeof(serialLines[0])) {
+    return;
+  }
+
+  SerialLine &line = serialLines[serialLineCount];
+  if (c == '\n') {
+    line.text[serialLineLength] = '\0';
+    line.timeMs = (simMicros() - traceStartTime) / 1000;
+    serialLineCount++;
+    serialLineLength = 0;
+  } else if (c != '\r' && serialLineLength < sizeof(line.text) - 1) {
+    line.text[serialLineLength++] = c;
+  }
+}
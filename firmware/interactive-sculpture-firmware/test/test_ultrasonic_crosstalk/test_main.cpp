@@ -0,0 +1,114 @@
+/**
+ * @file        test_main.cpp
+ * @author      Simon Håkansson
+ * @date        2025-10-08
+ * @brief       Native test of the ultrasonic crosstalk rejection.
+ *
+ * @details     Runs the ranging engine on its own with both sensors in one
+ * ping slot and lets them hear each other's bursts. Whichever sensor's echo
+ * a burst cuts short, the one triggered before it or the one triggered
+ * after it, the short reading must be held back and the sensor keep
+ * publishing its real distance.
+ *
+ * @copyright   Copyright (c) 2025 Simon Håkansson
+ *
+ * This software is released under the MIT License.
+ * See the LICENSE file in the project root for the full license text.
+ */
+//-------------[ LIBRARIES ]-------------
+#include <unity.h>
+#include <hal.h>
+#include <config.h>
+#include <ultrasonic.h>
+
+//-------------[ INITIALIZATION ]-------------
+// Simulated time between loop() passes, as in the native build
+const unsigned long LOOP_STEP_US = 100;
+
+// Ranging cycles to run with crosstalk, enough for both trigger orders
+const uint8_t CROSSTALK_CYCLES = 10;
+
+// Largest error a published reading may have, from the loop step alone
+const float READING_TOLERANCE_CM = 2;
+
+//-------------[ FUNCTION PROTOTYPES ]-------------
+static void setDistances(float approachCm, float interactionCm);
+static void runCycles(uint8_t cycles);
+static void assertDistancesHold(float approachCm, float interactionCm);
+
+//-------------[ TESTS ]-------------
+void setUp() {
+  simSetUltrasonicCrosstalk(0);
+}
+
+void tearDown() {}
+
+/**
+ * @brief  A burst sent while a sensor's echo is out does not shorten it.
+ *
+ * @details Over a short path the second sensor's burst arrives while the
+ * far approach echo is still out, at about 60 cm instead of 95 cm.
+ */
+void test_burst_after_trigger_is_held_back() {
+  setDistances(95, 20);
+  simSetUltrasonicCrosstalk(20);
+  assertDistancesHold(95, 20);
+}
+
+/**
+ * @brief  A burst sent before a sensor was triggered does not shorten it.
+ *
+ * @details Over a long path the first sensor's burst arrives a few hundred
+ * microseconds into the second sensor's echo, which then reads about 12 cm.
+ */
+void test_burst_before_trigger_is_held_back() {
+  setDistances(80, 45);
+  simSetUltrasonicCrosstalk(125);
+  assertDistancesHold(80, 45);
+}
+
+//-------------[ MAIN FUNCTION ]-------------
+int main() {
+  simReset();
+  simAttachUltrasonic(APPROACH_TRIG_PIN, APPROACH_ECHO_PIN);
+  simAttachUltrasonic(INTERACTION_TRIG_PIN, INTERACTION_ECHO_PIN);
+  initializeUltrasonicSensors();
+
+  UNITY_BEGIN();
+  RUN_TEST(test_burst_after_trigger_is_held_back);
+  RUN_TEST(test_burst_before_trigger_is_held_back);
+  return UNITY_END();
+}
+
+//-------------[ HELPER FUNCTIONS ]-------------
+/**
+ * @brief  Moves both targets and lets the sensors settle on them without crosstalk.
+ */
+static void setDistances(float approachCm, float interactionCm) {
+  simSetUltrasonicDistance(APPROACH_ECHO_PIN, approachCm);
+  simSetUltrasonicDistance(INTERACTION_ECHO_PIN, interactionCm);
+  runCycles(3);
+}
+
+/**
+ * @brief  Runs the ranging engine until it has published a number of cycles.
+ */
+static void runCycles(uint8_t cycles) {
+  while (cycles > 0) {
+    if (updateUltrasonicRanging()) {
+      cycles--;
+    }
+    simAdvanceMicros(LOOP_STEP_US);
+  }
+}
+
+/**
+ * @brief  Checks that every cycle publishes the real distances.
+ */
+static void assertDistancesHold(float approachCm, float interactionCm) {
+  for (uint8_t i = 0; i < CROSSTALK_CYCLES; i++) {
+    runCycles(1);
+    TEST_ASSERT_FLOAT_WITHIN(READING_TOLERANCE_CM, approachCm, getUltrasonicDistance(APPROACH_SENSOR));
+    TEST_ASSERT_FLOAT_WITHIN(READING_TOLERANCE_CM, interactionCm, getUltrasonicDistance(INTERACTION_SENSOR));
+  }
+}
@@ -22,7 +22,33 @@ import os
 # -------------[ LOGIC BRIDGE ]-------------
 # Serial connection
 SERIAL_PORT = "COM7"  # Adjust this to your Arduino's serial port
-BAUD_RATE = 9600 # Match the baud rate in config.h
+BAUD_RATE = 9600 # Match the boot baud rate in config.h
+
+# Faster rates to negotiate after boot, fastest first. Match NEGOTIATED_BAUD_RATES in config.h.
+NEGOTIATED_BAUD_RATES = [1000000, 500000, 250000]
+BAUD_REPLY_TIMEOUT = 0.5    # Seconds to wait for each negotiation reply
+BAUD_PROPOSE_ATTEMPTS = 6   # Proposals sent at boot rate before giving up (covers the Uno's reset)
+LINK_ERROR_LIMIT = 8        # Garbled messages per window before falling back
+LINK_ERROR_WINDOW = 1.0     # Seconds
+
+# Serial protocol: "text" lines or "binary" COBS frames (see serial_protocol.py)
+SERIAL_PROTOCOL = "text"
+
+# Binary ids of the movement states, in the order of MovementState in config.h
+MOVEMENT_STATE_IDS = {
+    "IDLE": 0,
+    "LISTEN": 1,
+    "REACTING_POSITIVE": 2,
+    "REACTING_NEGATIVE": 3,
+    "REACTING_NEUTRAL": 4
+}
+
+# Ids of the leaf waveforms, in the order of WaveformId in config.h
+WAVEFORM_IDS = {
+    "SINE": 0,
+    "SHIVER": 1,
+    "BLOOM": 2
+}
 
 # time to hold reaction movement set before returning to idle, in seconds 
 REACTION_TIMING = 5
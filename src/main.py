@@ -37,11 +37,13 @@ from voice_transcription import record_audio, transcribe_audio
 from sentiment_analysis import analyze_sentiment
 from language_synthesis import get_llm_response
 from voice_synthesis import synthesize_speech
+from serial_protocol import HostLink
 
 # import configuration settings
 from config import ( WHISPER_MODEL, OUTPUT_WAV_PATH, MODEL_ONNX_PATH, MODEL_JSON_PATH, 
                     SERIAL_PORT, BAUD_RATE, SENTIMENT_TO_MOVEMENT_MAP, STANDARD_STATE,
-                    SENTIMENT_GOOD_THRESHOLD, SENTIMENT_BAD_THRESHOLD, REACTION_TIMING)
+                    SENTIMENT_GOOD_THRESHOLD, SENTIMENT_BAD_THRESHOLD, REACTION_TIMING,
+                    SERIAL_PROTOCOL)
 
 # -------------[ INITIALIZATION ]-------------
 # Initialize the Whisper model
@@ -68,7 +70,7 @@ print("Piper model loaded.")
 
 
 # -------------[ FUNCTIONS ]-------------
-def ai_pipeline(ser):
+def ai_pipeline(link):
     """
     @brief  Executes the full AI conversation pipeline.
     
@@ -86,7 +88,7 @@ def ai_pipeline(ser):
 
     # Send the command to the Arduino over the existing serial connection
     command = sentiment_to_movement(sentiment_score)
-    ser.write(command.encode('utf-8'))
+    link.send_command(command)
     print(f"Sent to Arduino: {command}")
 
     # Step 3: Get LLM reply
@@ -106,7 +108,7 @@ def ai_pipeline(ser):
     # Send command for sculpture to go back to the base state after it has reacted
     time.sleep(REACTION_TIMING)
     command = STANDARD_STATE
-    ser.write(command.encode('utf-8'))
+    link.send_command(command)
     print(f"Sent to Arduino: {command}")
 
 def main_loop():
@@ -120,13 +122,13 @@ def main_loop():
     try:
         with serial.Serial(SERIAL_PORT , BAUD_RATE, timeout=1) as ser:
                 print(f"Connected to Arduino on {ser.portstr}")
+                link = HostLink(ser, SERIAL_PROTOCOL)
                 while True:
-                    if ser.in_waiting > 0:
-                        line = ser.readline().decode('utf-8').strip()
+                    for line in link.read_messages():
                         print(f"Received from Arduino: {line}")
                         if line == "event:user_interaction_start":
                             print("User interaction event received. Starting AI pipeline.")
-                            ai_pipeline(ser)
+                            ai_pipeline(link)
 
     except serial.SerialException as e:
         print(f"Serial Error: {e}")
@@ -0,0 +1,428 @@
+"""
+@file       serial_protocol.py
+@author     Simon Håkansson
+@date       2025-09-15
+@brief      Host side of the serial link to the sculpture firmware.
+
+@details    The firmware speaks either text lines ("event:...", "set_state:...")
+            or, after the host sends "protocol:binary", COBS-framed binary
+            messages. A binary frame is an opcode, a payload and a CRC8
+            (polynomial 0x07), COBS-encoded and ended by a 0x00 byte. This
+            module hides the difference so the orchestrator always deals in the
+            text form of events and commands. See host_protocol.h in the firmware.
+
+            The link boots at BAUD_RATE and then negotiates the fastest rate in
+            NEGOTIATED_BAUD_RATES that survives a confirmation round trip. Too
+            many garbled messages, or a "baud:fallback" from the firmware, drop
+            the link back to BAUD_RATE and renegotiate at the next slower rate.
+            See link_speed.h in the firmware.
+
+@copyright  Copyright (c) 2025 Simon Håkansson
+
+This software is released under the MIT License.
+See the LICENSE file in the project root for the full license text.
+"""
+
+# -------------[ LIBRARIES ]-------------
+import struct
+import time
+
+from config import (MOVEMENT_STATE_IDS, WAVEFORM_IDS, BAUD_RATE, NEGOTIATED_BAUD_RATES, BAUD_REPLY_TIMEOUT,
+                    BAUD_PROPOSE_ATTEMPTS, LINK_ERROR_LIMIT, LINK_ERROR_WINDOW)
+
+# -------------[ PROTOCOL CONSTANTS ]-------------
+# Opcodes, host to firmware below 0x80 and firmware to host above
+OPCODE_SET_STATE = 0x01
+OPCODE_SET_TELEMETRY = 0x02
+OPCODE_TEXT_MODE = 0x03
+OPCODE_UPLOAD_MOVEMENT = 0x04
+OPCODE_ACTIVATE_MOVEMENTS = 0x05
+OPCODE_DEFAULT_MOVEMENTS = 0x06
+OPCODE_EVENT = 0x81
+OPCODE_MOVEMENT_STATE = 0x82
+OPCODE_DISTANCES = 0x83
+OPCODE_LEAF_STATE = 0x84
+OPCODE_LINK_FALLBACK = 0x85
+OPCODE_MOVEMENT_RESULT = 0x86
+
+# Telemetry stream bits for OPCODE_SET_TELEMETRY
+TELEMETRY_DISTANCES = 0x01
+TELEMETRY_LEAVES = 0x02
+
+# Event names, indexed by the binary event id (HostEvent in the firmware)
+EVENT_NAMES = [
+    "user_approach_start",
+    "user_approach_end",
+    "user_interaction_start",
+    "user_interaction_end",
+    "ready",
+]
+
+# Replies to movement set uploads, indexed by the binary result id
+MOVEMENT_RESULT_NAMES = [
+    "movement:rejected",
+    "movement:staged",
+    "movements:active",
+]
+
+# Seconds to wait for the firmware to acknowledge the switch to binary
+PROTOCOL_SWITCH_TIMEOUT = 2.0
+
+# -------------[ FRAMING ]-------------
+def crc8(data: bytes) -> int:
+    """
+    @brief  Computes the CRC8 (polynomial 0x07, start value 0) of some bytes.
+
+    @param data The bytes to check.
+    @return The CRC8 as an int.
+    """
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+def cobs_encode(data: bytes) -> bytes:
+    """
+    @brief  COBS-encodes a block of bytes so that it contains no 0x00.
+
+    @param data The bytes to encode.
+    @return The encoded bytes, without the 0x00 delimiter.
+    """
+    encoded = bytearray()
+    block = bytearray()
+    for byte in data:
+        if byte == 0:
+            encoded.append(len(block) + 1)
+            encoded += block
+            block.clear()
+        else:
+            block.append(byte)
+            if len(block) == 254:
+                encoded.append(0xFF)
+                encoded += block
+                block.clear()
+    encoded.append(len(block) + 1)
+    encoded += block
+    return bytes(encoded)
+
+def cobs_decode(data: bytes) -> bytes:
+    """
+    @brief  Decodes a COBS-encoded block of bytes.
+
+    @param data The encoded bytes, without the 0x00 delimiter.
+    @return The decoded bytes.
+    @throws ValueError If the encoding is invalid.
+    """
+    decoded = bytearray()
+    index = 0
+    while index < len(data):
+        code = data[index]
+        if code == 0 or index + code > len(data):
+            raise ValueError("Invalid COBS block")
+        decoded += data[index + 1:index + code]
+        index += code
+        if code < 0xFF and index < len(data):
+            decoded.append(0)
+    return bytes(decoded)
+
+def encode_frame(opcode: int, payload: bytes = b"") -> bytes:
+    """
+    @brief  Builds a complete binary frame ready to write to the port.
+
+    @param opcode The frame opcode.
+    @param payload The payload bytes.
+    @return The COBS-encoded frame including the 0x00 delimiter.
+    """
+    frame = bytes([opcode]) + payload
+    return cobs_encode(frame + bytes([crc8(frame)])) + b"\x00"
+
+def decode_frame(data: bytes):
+    """
+    @brief  Decodes one received frame.
+
+    @param data The encoded bytes, without the 0x00 delimiter.
+    @return A tuple (opcode, payload), or None if the frame is corrupt.
+    """
+    try:
+        frame = cobs_decode(data)
+    except ValueError:
+        return None
+    if len(frame) < 2 or crc8(frame[:-1]) != frame[-1]:
+        return None
+    return frame[0], frame[1:-1]
+
+# -------------[ HOST LINK ]-------------
+class HostLink:
+    """
+    @brief  Wraps the serial port and speaks the configured protocol.
+
+    @details Incoming binary frames are translated back to the text messages
+             the firmware would have sent, so callers do not care which
+             protocol is in use. Telemetry frames are returned as
+             "distances:<approach mm>,<interaction mm>" (65535 when out of
+             range) and
+             "leaf:<index>,<phase>,<ticks>".
+    """
+
+    def __init__(self, ser, protocol: str = "text", negotiate: bool = True):
+        """
+        @brief  Sets up the link, negotiates its speed and picks the protocol.
+
+        @param ser An open serial.Serial port, at BAUD_RATE.
+        @param protocol Either "text" or "binary".
+        @param negotiate Whether to negotiate a faster baud rate.
+        """
+        self.ser = ser
+        self.protocol = protocol
+        self.binary = False
+        self.buffer = bytearray()
+        self.rates = list(NEGOTIATED_BAUD_RATES) if negotiate else []
+        self.errors = 0
+        self.error_window = time.monotonic()
+        self.connect()
+
+    def connect(self):
+        """
+        @brief  Negotiates the link speed and then switches protocol if configured.
+        """
+        self.negotiate_baud()
+        if self.protocol == "binary":
+            self.enable_binary()
+
+    def negotiate_baud(self):
+        """
+        @brief  Moves the link to the fastest rate that both sides confirm.
+
+        @details Rates that fail are removed, so a later renegotiation starts
+                 at the next slower rate. If none work the link stays at BAUD_RATE.
+        """
+        while self.rates:
+            rate = self.rates[0]
+            if self._try_baud(rate):
+                print(f"Serial link running at {rate} baud")
+                return
+            self.rates.pop(0)
+        print(f"Serial link running at {BAUD_RATE} baud")
+
+    def _try_baud(self, rate: int) -> bool:
+        """
+        @brief  Proposes one rate and confirms it at the new speed.
+
+        @param rate The baud rate to try.
+        @return True if the firmware confirmed the rate.
+        """
+        self.ser.baudrate = BAUD_RATE
+        for _ in range(BAUD_PROPOSE_ATTEMPTS):
+            self.ser.reset_input_buffer()
+            self.ser.write(f"baud:{rate}\n".encode('utf-8'))
+            reply = self._wait_for_line(("baud:ack:", "baud:nak"))
+            if reply == "baud:nak":
+                return False
+            if reply:
+                break
+        else:
+            return False
+
+        self.ser.flush()
+        self.ser.baudrate = rate
+        self.ser.reset_input_buffer()
+        self.ser.write(b"baud:confirm\n")
+        if self._wait_for_line(("baud:ok",)):
+            return True
+
+        # The firmware reverts on its own once the confirmation window closes
+        self.ser.baudrate = BAUD_RATE
+        time.sleep(BAUD_REPLY_TIMEOUT)
+        return False
+
+    def _wait_for_line(self, prefixes) -> str:
+        """
+        @brief  Reads text lines until one starts with any of the prefixes.
+
+        @param prefixes The accepted line prefixes.
+        @return The matching line, or an empty string on timeout.
+        """
+        deadline = time.monotonic() + BAUD_REPLY_TIMEOUT
+        while time.monotonic() < deadline:
+            line = self.ser.readline().decode('utf-8', errors='replace').strip()
+            if line.startswith(tuple(prefixes)):
+                return line
+        return ""
+
+    def fall_back(self, notify: bool = True):
+        """
+        @brief  Drops to BAUD_RATE and renegotiates without the failing rate.
+
+        @param notify Whether to tell the firmware to drop as well. Not needed
+                      when the firmware announced the fallback itself.
+        """
+        if self.rates and self.ser.baudrate == self.rates[0]:
+            self.rates.pop(0)
+        print("Serial link errors, renegotiating")
+        if notify:
+            if self.binary:
+                self.ser.write(encode_frame(OPCODE_TEXT_MODE))
+            self.ser.write(b"baud:reset\n")
+            self.ser.flush()
+        self.ser.baudrate = BAUD_RATE
+        self.binary = False
+        self.buffer.clear()
+        self.errors = 0
+        # Give the firmware time to notice the errors or close its confirmation window
+        time.sleep(BAUD_REPLY_TIMEOUT)
+        self.ser.reset_input_buffer()
+        self.connect()
+
+    def _report_error(self):
+        """
+        @brief  Counts a garbled message and falls back when there are too many.
+        """
+        if time.monotonic() - self.error_window >= LINK_ERROR_WINDOW:
+            self.error_window = time.monotonic()
+            self.errors = 0
+        self.errors += 1
+        if self.errors >= LINK_ERROR_LIMIT and self.ser.baudrate != BAUD_RATE:
+            self.fall_back()
+
+    def enable_binary(self):
+        """
+        @brief  Asks the firmware to switch to binary frames and waits for the acknowledgement.
+        """
+        self.ser.write(b"protocol:binary\n")
+        deadline = time.monotonic() + PROTOCOL_SWITCH_TIMEOUT
+        while time.monotonic() < deadline:
+            line = self.ser.readline().decode('utf-8', errors='replace').strip()
+            if line == "protocol:binary":
+                self.binary = True
+                self.buffer.clear()
+                return
+        raise TimeoutError("Firmware did not acknowledge the binary protocol")
+
+    def set_telemetry(self, mask: int):
+        """
+        @brief  Switches firmware telemetry streams on or off (binary only).
+
+        @param mask A combination of the TELEMETRY_* bits.
+        """
+        if self.binary:
+            self.ser.write(encode_frame(OPCODE_SET_TELEMETRY, bytes([mask])))
+
+    def send_command(self, command: str):
+        """
+        @brief  Sends a text-form command such as "set_state:IDLE".
+
+        @param command The command in its text form.
+        """
+        if not self.binary:
+            self.ser.write((command + "\n").encode('utf-8'))
+            return
+        state = command.partition("set_state:")[2]
+        if state in MOVEMENT_STATE_IDS:
+            self.ser.write(encode_frame(OPCODE_SET_STATE, bytes([MOVEMENT_STATE_IDS[state]])))
+        else:
+            raise ValueError(f"No binary form for command: {command}")
+
+    def upload_movement_set(self, state: str, amplitude: float, center_angle: float,
+                            speed_factor: float, waveform: str = "SINE"):
+        """
+        @brief  Stages new movement parameters for a state.
+
+        @details The firmware checks the set against the leaves' angle limits
+                 and answers "movement:staged" or "movement:rejected". Staged
+                 sets only take effect after activate_movement_sets().
+
+        @param state The movement state name, a key of MOVEMENT_STATE_IDS.
+        @param amplitude The swing either side of the center in degrees.
+        @param center_angle The midpoint of the movement in degrees.
+        @param speed_factor The speed relative to each leaf's baseline.
+        @param waveform The waveform name, a key of WAVEFORM_IDS.
+        """
+        state_id = MOVEMENT_STATE_IDS[state]
+        waveform_id = WAVEFORM_IDS[waveform]
+        if self.binary:
+            payload = struct.pack("<BfffB", state_id, amplitude, center_angle, speed_factor, waveform_id)
+            self.ser.write(encode_frame(OPCODE_UPLOAD_MOVEMENT, payload))
+        else:
+            command = f"movement:{state_id},{amplitude:g},{center_angle:g},{speed_factor:g},{waveform_id}\n"
+            self.ser.write(command.encode('utf-8'))
+
+    def activate_movement_sets(self):
+        """
+        @brief  Makes the staged movement sets active and saves them on the firmware.
+        """
+        if self.binary:
+            self.ser.write(encode_frame(OPCODE_ACTIVATE_MOVEMENTS))
+        else:
+            self.ser.write(b"movements:activate\n")
+
+    def stage_default_movement_sets(self):
+        """
+        @brief  Stages the firmware's built-in movement sets, to be activated as usual.
+        """
+        if self.binary:
+            self.ser.write(encode_frame(OPCODE_DEFAULT_MOVEMENTS))
+        else:
+            self.ser.write(b"movements:defaults\n")
+
+    def read_messages(self) -> list:
+        """
+        @brief  Returns every complete message waiting on the port.
+
+        @return A list of messages in their text form.
+        """
+        if self.ser.in_waiting == 0:
+            return []
+        if not self.binary:
+            try:
+                line = self.ser.readline().decode('utf-8').strip()
+            except UnicodeDecodeError:
+                self._report_error()
+                return []
+            if line == "baud:fallback":
+                self.fall_back(notify=False)
+                return []
+            return [line]
+
+        messages = []
+        self.buffer += self.ser.read(self.ser.in_waiting)
+        while b"\x00" in self.buffer:
+            data, _, rest = bytes(self.buffer).partition(b"\x00")
+            self.buffer = bytearray(rest)
+            frame = decode_frame(data)
+            if frame is None:
+                self._report_error()
+                if not self.binary:
+                    return messages
+                continue
+            if frame[0] == OPCODE_LINK_FALLBACK:
+                self.fall_back(notify=False)
+                return messages
+            messages.append(self._frame_to_text(*frame))
+        return [message for message in messages if message]
+
+    def _frame_to_text(self, opcode: int, payload: bytes) -> str:
+        """
+        @brief  Translates a firmware frame to its text form.
+
+        @param opcode The frame opcode.
+        @param payload The payload bytes.
+        @return The message as text, or an empty string for unknown frames.
+        """
+        if opcode == OPCODE_EVENT and len(payload) == 1 and payload[0] < len(EVENT_NAMES):
+            return f"event:{EVENT_NAMES[payload[0]]}"
+        if opcode == OPCODE_MOVEMENT_STATE and len(payload) == 1:
+            names = {value: name for name, value in MOVEMENT_STATE_IDS.items()}
+            return f"state:{names.get(payload[0], payload[0])}"
+        if opcode == OPCODE_DISTANCES and len(payload) == 4:
+            approach = int.from_bytes(payload[0:2], "little")
+            interaction = int.from_bytes(payload[2:4], "little")
+            return f"distances:{approach},{interaction}"
+        if opcode == OPCODE_LEAF_STATE and len(payload) == 5:
+            phase = int.from_bytes(payload[1:3], "little")
+            ticks = int.from_bytes(payload[3:5], "little")
+            return f"leaf:{payload[0]},{phase},{ticks}"
+        if opcode == OPCODE_MOVEMENT_RESULT and len(payload) == 1 and payload[0] < len(MOVEMENT_RESULT_NAMES):
+            return MOVEMENT_RESULT_NAMES[payload[0]]
+        return ""